@@ -0,0 +1,339 @@
+#include "Compression.h"
+#include "ZlibApi.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+//-------------------------------------------------------------------------
+
+namespace Compression
+{
+    // Each block is compressed as an independent gzip member, larger blocks compress slightly better but reduce parallelism on small files
+    static size_t const g_blockSize = 4 * 1024 * 1024;
+    static size_t const g_streamBufferSize = 256 * 1024;
+
+    // Ascii FBX files typically compress 5 to 10 times, binary files far less since their arrays are already compressed
+    static uint64_t const g_estimatedCompressionRatio = 10;
+
+    //-------------------------------------------------------------------------
+
+    namespace
+    {
+        static bool CompressBlock( std::vector<char> const& input, std::vector<char>& output )
+        {
+            z_stream stream;
+            memset( &stream, 0, sizeof( stream ) );
+            if ( Zlib::DeflateInit2( &stream, Zlib::s_defaultCompression, Zlib::s_gzipWindowBits ) != Zlib::s_resultOK )
+            {
+                return false;
+            }
+
+            output.resize( deflateBound( &stream, (unsigned long) input.size() ) );
+            stream.next_in = (unsigned char const*) input.data();
+            stream.avail_in = (unsigned int) input.size();
+            stream.next_out = (unsigned char*) output.data();
+            stream.avail_out = (unsigned int) output.size();
+
+            int const result = deflate( &stream, Zlib::s_flushFinish );
+            output.resize( stream.total_out );
+            deflateEnd( &stream );
+
+            return result == Zlib::s_resultStreamEnd;
+        }
+
+        // Inflates the input file, calling the consumer for each decompressed chunk. Multi-member files are supported.
+        // The consumer returns false to stop decompression early.
+        template<typename ConsumerFunction>
+        static bool DecompressFileStream( std::string const& inputFilePath, std::string& errorMessage, ConsumerFunction consumer )
+        {
+            FILE* pInputFile = nullptr;
+            if ( fopen_s( &pInputFile, inputFilePath.c_str(), "rb" ) != 0 )
+            {
+                errorMessage = "failed to open compressed file";
+                return false;
+            }
+
+            z_stream stream;
+            memset( &stream, 0, sizeof( stream ) );
+            if ( Zlib::InflateInit2( &stream, Zlib::s_autoDetectWindowBits ) != Zlib::s_resultOK )
+            {
+                fclose( pInputFile );
+                errorMessage = "failed to initialize decompression";
+                return false;
+            }
+
+            //-------------------------------------------------------------------------
+
+            std::vector<unsigned char> inputBuffer( g_streamBufferSize );
+            std::vector<unsigned char> outputBuffer( g_streamBufferSize );
+            bool isInputComplete = false;
+            bool isMemberComplete = false;
+            bool wasStopped = false;
+            bool succeeded = true;
+
+            while ( true )
+            {
+                if ( stream.avail_in == 0 && !isInputComplete )
+                {
+                    size_t const readSize = fread( inputBuffer.data(), 1, inputBuffer.size(), pInputFile );
+                    if ( readSize == 0 )
+                    {
+                        isInputComplete = true;
+                    }
+                    else
+                    {
+                        stream.next_in = inputBuffer.data();
+                        stream.avail_in = (unsigned int) readSize;
+                    }
+                }
+
+                // Once all the input has been read, we keep inflating to flush the output that didn't fit in the buffer until the last member ends
+                if ( isInputComplete && isMemberComplete )
+                {
+                    break;
+                }
+
+                stream.next_out = outputBuffer.data();
+                stream.avail_out = (unsigned int) outputBuffer.size();
+
+                int const result = inflate( &stream, Zlib::s_flushNone );
+                if ( result != Zlib::s_resultOK && result != Zlib::s_resultStreamEnd && result != Zlib::s_resultBufferError )
+                {
+                    errorMessage = "corrupt compressed data";
+                    succeeded = false;
+                    break;
+                }
+
+                // No progress is possible without more input, so the last member is truncated
+                if ( result == Zlib::s_resultBufferError && isInputComplete )
+                {
+                    break;
+                }
+
+                size_t const decompressedSize = outputBuffer.size() - stream.avail_out;
+                if ( decompressedSize > 0 && !consumer( (char const*) outputBuffer.data(), decompressedSize ) )
+                {
+                    wasStopped = true;
+                    break;
+                }
+
+                // Files compressed in blocks contain multiple gzip members, so we reset and keep going until we run out of input
+                isMemberComplete = ( result == Zlib::s_resultStreamEnd );
+                if ( isMemberComplete )
+                {
+                    inflateReset( &stream );
+                }
+            }
+
+            inflateEnd( &stream );
+            fclose( pInputFile );
+
+            if ( succeeded && !wasStopped && !isMemberComplete )
+            {
+                errorMessage = "truncated compressed data";
+                succeeded = false;
+            }
+
+            return succeeded;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+
+    bool IsCompressedFile( std::string const& filePath )
+    {
+        FILE* fp = nullptr;
+        if ( fopen_s( &fp, filePath.c_str(), "rb" ) != 0 )
+        {
+            return false;
+        }
+
+        unsigned char magic[2] = { 0, 0 };
+        size_t const readLength = fread( magic, 1, 2, fp );
+        fclose( fp );
+
+        return readLength == 2 && magic[0] == 0x1F && magic[1] == 0x8B;
+    }
+
+    bool HasCompressedFileExtension( std::string const& filePath )
+    {
+        size_t const extensionLength = strlen( s_compressedFileExtension );
+        if ( filePath.length() < extensionLength )
+        {
+            return false;
+        }
+
+        return _stricmp( filePath.c_str() + filePath.length() - extensionLength, s_compressedFileExtension ) == 0;
+    }
+
+    bool CompressFile( std::string const& inputFilePath, std::string const& outputFilePath, int numThreads, std::string& errorMessage )
+    {
+        assert( numThreads > 0 );
+
+        FILE* pInputFile = nullptr;
+        if ( fopen_s( &pInputFile, inputFilePath.c_str(), "rb" ) != 0 )
+        {
+            errorMessage = "failed to open input file";
+            return false;
+        }
+
+        FILE* pOutputFile = nullptr;
+        if ( fopen_s( &pOutputFile, outputFilePath.c_str(), "wb" ) != 0 )
+        {
+            fclose( pInputFile );
+            errorMessage = "failed to open output file";
+            return false;
+        }
+
+        //-------------------------------------------------------------------------
+
+        // We read as many blocks as we have threads, compress them in parallel and then write them out in order
+        std::vector<std::vector<char>> inputBlocks( numThreads );
+        std::vector<std::vector<char>> outputBlocks( numThreads );
+        std::vector<char> blockResults( numThreads );
+        size_t numBlocksWritten = 0;
+        bool isInputComplete = false;
+        bool succeeded = true;
+
+        while ( !isInputComplete && succeeded )
+        {
+            int numBlocks = 0;
+            while ( numBlocks < numThreads )
+            {
+                auto& inputBlock = inputBlocks[numBlocks];
+                inputBlock.resize( g_blockSize );
+                size_t const readSize = fread( inputBlock.data(), 1, g_blockSize, pInputFile );
+                inputBlock.resize( readSize );
+
+                // Always write at least one block so that empty files still produce a valid gzip file
+                if ( readSize > 0 || ( numBlocks == 0 && numBlocksWritten == 0 ) )
+                {
+                    numBlocks++;
+                }
+
+                if ( readSize < g_blockSize )
+                {
+                    isInputComplete = true;
+                    break;
+                }
+            }
+
+            //-------------------------------------------------------------------------
+
+            std::vector<std::thread> threads;
+            for ( int i = 1; i < numBlocks; i++ )
+            {
+                threads.emplace_back( [&inputBlocks, &outputBlocks, &blockResults, i] () { blockResults[i] = CompressBlock( inputBlocks[i], outputBlocks[i] ); } );
+            }
+
+            if ( numBlocks > 0 )
+            {
+                blockResults[0] = CompressBlock( inputBlocks[0], outputBlocks[0] );
+            }
+
+            for ( auto& thread : threads )
+            {
+                thread.join();
+            }
+
+            //-------------------------------------------------------------------------
+
+            for ( int i = 0; i < numBlocks; i++ )
+            {
+                if ( !blockResults[i] )
+                {
+                    errorMessage = "failed to compress data";
+                    succeeded = false;
+                    break;
+                }
+
+                if ( fwrite( outputBlocks[i].data(), 1, outputBlocks[i].size(), pOutputFile ) != outputBlocks[i].size() )
+                {
+                    errorMessage = "failed to write output file";
+                    succeeded = false;
+                    break;
+                }
+
+                numBlocksWritten++;
+            }
+        }
+
+        fclose( pInputFile );
+        fclose( pOutputFile );
+
+        if ( !succeeded )
+        {
+            remove( outputFilePath.c_str() );
+        }
+
+        return succeeded;
+    }
+
+    bool DecompressFile( std::string const& inputFilePath, std::string const& outputFilePath, std::string& errorMessage )
+    {
+        FILE* pOutputFile = nullptr;
+        if ( fopen_s( &pOutputFile, outputFilePath.c_str(), "wb" ) != 0 )
+        {
+            errorMessage = "failed to open output file";
+            return false;
+        }
+
+        bool writeFailed = false;
+        bool succeeded = DecompressFileStream( inputFilePath, errorMessage, [pOutputFile, &writeFailed] ( char const* pData, size_t dataSize )
+        {
+            writeFailed = fwrite( pData, 1, dataSize, pOutputFile ) != dataSize;
+            return !writeFailed;
+        } );
+
+        fclose( pOutputFile );
+
+        if ( writeFailed )
+        {
+            errorMessage = "failed to write output file";
+            succeeded = false;
+        }
+
+        if ( !succeeded )
+        {
+            remove( outputFilePath.c_str() );
+        }
+
+        return succeeded;
+    }
+
+    uint64_t EstimateDecompressedSize( std::string const& filePath )
+    {
+        FILE* fp = nullptr;
+        if ( fopen_s( &fp, filePath.c_str(), "rb" ) != 0 )
+        {
+            return 0;
+        }
+
+        uint64_t trailerSize = 0;
+        _fseeki64( fp, 0, SEEK_END );
+        int64_t const fileSize = _ftelli64( fp );
+
+        // The smallest gzip member is a 10 byte header and an 8 byte trailer, the size is the last 4 bytes in little endian
+        unsigned char sizeBytes[4];
+        if ( fileSize >= 18 && _fseeki64( fp, fileSize - 4, SEEK_SET ) == 0 && fread( sizeBytes, 1, 4, fp ) == 4 )
+        {
+            trailerSize = uint64_t( sizeBytes[0] ) | ( uint64_t( sizeBytes[1] ) << 8 ) | ( uint64_t( sizeBytes[2] ) << 16 ) | ( uint64_t( sizeBytes[3] ) << 24 );
+        }
+
+        fclose( fp );
+        return std::max( trailerSize, uint64_t( std::max( fileSize, int64_t( 0 ) ) ) * g_estimatedCompressionRatio );
+    }
+
+    bool DecompressFileToMemory( std::string const& inputFilePath, std::vector<char>& decompressedData, std::string& errorMessage, uint64_t maxDecompressedSize )
+    {
+        decompressedData.clear();
+        return DecompressFileStream( inputFilePath, errorMessage, [&decompressedData, maxDecompressedSize] ( char const* pData, size_t dataSize )
+        {
+            size_t const sizeToCopy = (size_t) std::min( (uint64_t) dataSize, maxDecompressedSize - decompressedData.size() );
+            decompressedData.insert( decompressedData.end(), pData, pData + sizeToCopy );
+            return decompressedData.size() < maxDecompressedSize;
+        } );
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------
+// Gzip compression for archived FBX files.
+// Files are compressed in independent blocks (one gzip member per block) so that the blocks can be compressed in parallel,
+// the result is a standard multi-member gzip file that any gzip tool can decompress.
+//-------------------------------------------------------------------------
+
+namespace Compression
+{
+    static char const* const s_compressedFileExtension = ".gz";
+
+    // Checks the file header for the gzip magic number
+    bool IsCompressedFile( std::string const& filePath );
+
+    bool HasCompressedFileExtension( std::string const& filePath );
+
+    // Compresses the input file, using the specified number of threads
+    bool CompressFile( std::string const& inputFilePath, std::string const& outputFilePath, int numThreads, std::string& errorMessage );
+
+    // Decompresses the input file to the output file, the data is streamed so the file is never fully loaded in memory
+    bool DecompressFile( std::string const& inputFilePath, std::string const& outputFilePath, std::string& errorMessage );
+
+    // Conservative estimate of the decompressed size. The gzip size trailer is exact for single member files under 4GB, but block compressed
+    // files have one trailer per member and only the last one is at the end of the file, so the estimate never goes below a typical
+    // compression ratio applied to the compressed size.
+    uint64_t EstimateDecompressedSize( std::string const& filePath );
+
+    // Decompresses the input file into memory, at most maxDecompressedSize bytes are decompressed
+    bool DecompressFileToMemory( std::string const& inputFilePath, std::vector<char>& decompressedData, std::string& errorMessage, uint64_t maxDecompressedSize = UINT64_MAX );
+}
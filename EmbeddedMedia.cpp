@@ -0,0 +1,1118 @@
+#include "EmbeddedMedia.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+
+//-------------------------------------------------------------------------
+
+namespace EmbeddedMedia
+{
+    static char const g_binaryMagic[] = "Kaydara FBX Binary  ";
+    static uint64_t const g_binaryHeaderSize = 27;
+    static size_t const g_copyBufferSize = 1024 * 1024;
+    static size_t const g_readWindowSize = 1024 * 1024;
+    static char const g_contentRecordName[] = "Content";
+    static size_t const g_base64LineLength = 128;
+
+    //-------------------------------------------------------------------------
+
+    namespace
+    {
+        struct RecordHeader
+        {
+            inline bool IsNull() const { return m_endOffset == 0; }
+            inline uint64_t GetChildrenOffset() const { return m_propertiesOffset + m_propertyListLength; }
+
+        public:
+
+            uint64_t                m_offset = 0;
+            uint64_t                m_endOffset = 0;
+            uint64_t                m_numProperties = 0;
+            uint64_t                m_propertyListLength = 0;
+            uint64_t                m_propertiesOffset = 0;
+            std::string             m_name;
+        };
+
+        struct VideoRecord
+        {
+            std::string             m_name;
+            int                     m_index = 0;
+            RecordHeader            m_header;
+            RecordHeader            m_contentHeader;
+            bool                    m_hasContent = false;
+            uint64_t                m_contentDataOffset = 0;
+            uint64_t                m_contentDataSize = 0;
+            std::string             m_fileName;
+        };
+
+        // Replaces a range of the file being rewritten with new data
+        struct Splice
+        {
+            uint64_t                m_offset = 0;
+            uint64_t                m_removedSize = 0;
+            uint64_t                m_insertedSize = 0;
+            std::vector<char>       m_bytes;
+            MediaBlob const*        m_pBlob = nullptr;      // Streamed from the media source after the bytes
+            bool                    m_isContentRecord = false;
+        };
+
+        //-------------------------------------------------------------------------
+
+        // Reads records and properties directly from the file, so we never need to load the whole file.
+        // Small reads go through a window of the file, since the record headers are mostly read in file order this avoids a seek and read per header.
+        class BinaryFileReader
+        {
+        public:
+
+            ~BinaryFileReader()
+            {
+                if ( m_pFile != nullptr )
+                {
+                    fclose( m_pFile );
+                }
+            }
+
+            bool Open( std::string const& filePath, std::string& errorMessage )
+            {
+                if ( fopen_s( &m_pFile, filePath.c_str(), "rb" ) != 0 )
+                {
+                    errorMessage = "failed to open file";
+                    return false;
+                }
+
+                _fseeki64( m_pFile, 0, SEEK_END );
+                m_fileSize = (uint64_t) _ftelli64( m_pFile );
+
+                char header[g_binaryHeaderSize];
+                if ( !ReadBytes( 0, header, sizeof( header ) ) || memcmp( header, g_binaryMagic, sizeof( g_binaryMagic ) ) != 0 )
+                {
+                    m_isBinary = false;
+                    return true;
+                }
+
+                uint32_t version = 0;
+                memcpy( &version, header + 23, sizeof( version ) );
+                m_isBinary = true;
+                m_is64Bit = version >= 7500;
+                return true;
+            }
+
+            inline bool IsBinary() const { return m_isBinary; }
+            inline bool Is64Bit() const { return m_is64Bit; }
+            inline uint64_t GetFileSize() const { return m_fileSize; }
+            inline FILE* GetFile() const { return m_pFile; }
+            inline uint64_t GetRecordHeaderSize() const { return m_is64Bit ? 25 : 13; }
+
+            bool ReadBytes( uint64_t offset, void* pBuffer, size_t size )
+            {
+                if ( offset + size > m_fileSize )
+                {
+                    return false;
+                }
+
+                // Large reads don't benefit from the window, so they go straight to the file
+                if ( size > g_readWindowSize / 2 )
+                {
+                    return _fseeki64( m_pFile, (int64_t) offset, SEEK_SET ) == 0 && fread( pBuffer, 1, size, m_pFile ) == size;
+                }
+
+                if ( offset < m_windowOffset || offset + size > m_windowOffset + m_window.size() )
+                {
+                    size_t const windowSize = (size_t) std::min( (uint64_t) g_readWindowSize, m_fileSize - offset );
+                    m_window.resize( windowSize );
+                    m_windowOffset = offset;
+                    if ( _fseeki64( m_pFile, (int64_t) offset, SEEK_SET ) != 0 || fread( m_window.data(), 1, windowSize, m_pFile ) != windowSize )
+                    {
+                        m_window.clear();
+                        return false;
+                    }
+                }
+
+                memcpy( pBuffer, m_window.data() + ( offset - m_windowOffset ), size );
+                return true;
+            }
+
+            bool ReadRecordHeader( uint64_t offset, RecordHeader& header )
+            {
+                unsigned char buffer[25];
+                uint64_t const headerSize = GetRecordHeaderSize();
+                if ( !ReadBytes( offset, buffer, (size_t) headerSize ) )
+                {
+                    return false;
+                }
+
+                header.m_offset = offset;
+                if ( m_is64Bit )
+                {
+                    memcpy( &header.m_endOffset, buffer, 8 );
+                    memcpy( &header.m_numProperties, buffer + 8, 8 );
+                    memcpy( &header.m_propertyListLength, buffer + 16, 8 );
+                }
+                else
+                {
+                    uint32_t values[3];
+                    memcpy( values, buffer, sizeof( values ) );
+                    header.m_endOffset = values[0];
+                    header.m_numProperties = values[1];
+                    header.m_propertyListLength = values[2];
+                }
+
+                uint8_t const nameLength = buffer[headerSize - 1];
+                header.m_name.resize( nameLength );
+                if ( nameLength > 0 && !ReadBytes( offset + headerSize, &header.m_name[0], nameLength ) )
+                {
+                    return false;
+                }
+
+                header.m_propertiesOffset = offset + headerSize + nameLength;
+
+                if ( header.IsNull() )
+                {
+                    return true;
+                }
+
+                return header.m_endOffset <= m_fileSize && header.GetChildrenOffset() <= header.m_endOffset;
+            }
+
+            // Reads the type of the property at the offset, strings are also read but raw data is only located
+            bool ReadProperty( uint64_t offset, char& type, std::string& stringValue, uint64_t& dataOffset, uint64_t& dataSize, uint64_t& nextOffset )
+            {
+                if ( !ReadBytes( offset, &type, 1 ) )
+                {
+                    return false;
+                }
+
+                dataOffset = offset + 1;
+                switch ( type )
+                {
+                    case 'C': dataSize = 1; break;
+                    case 'Y': dataSize = 2; break;
+                    case 'I': case 'F': dataSize = 4; break;
+                    case 'L': case 'D': dataSize = 8; break;
+
+                    case 'S':
+                    case 'R':
+                    {
+                        uint32_t length = 0;
+                        if ( !ReadBytes( offset + 1, &length, sizeof( length ) ) )
+                        {
+                            return false;
+                        }
+
+                        dataOffset = offset + 5;
+                        dataSize = length;
+
+                        if ( type == 'S' )
+                        {
+                            stringValue.resize( length );
+                            if ( length > 0 && !ReadBytes( dataOffset, &stringValue[0], length ) )
+                            {
+                                return false;
+                            }
+                        }
+                    }
+                    break;
+
+                    case 'f': case 'd': case 'l': case 'i': case 'b':
+                    {
+                        uint32_t arrayHeader[3];
+                        if ( !ReadBytes( offset + 1, arrayHeader, sizeof( arrayHeader ) ) )
+                        {
+                            return false;
+                        }
+
+                        dataOffset = offset + 13;
+                        dataSize = arrayHeader[2];
+                    }
+                    break;
+
+                    default:
+                    return false;
+                }
+
+                nextOffset = dataOffset + dataSize;
+                return nextOffset <= m_fileSize;
+            }
+
+            // Reads the headers of the direct children of the record (or of the top-level records if no record is specified)
+            bool ReadChildRecords( RecordHeader const* pParent, std::vector<RecordHeader>& outChildren )
+            {
+                outChildren.clear();
+
+                uint64_t offset = ( pParent != nullptr ) ? pParent->GetChildrenOffset() : g_binaryHeaderSize;
+                uint64_t const endOffset = ( pParent != nullptr ) ? pParent->m_endOffset : m_fileSize;
+                while ( offset + GetRecordHeaderSize() <= endOffset )
+                {
+                    RecordHeader header;
+                    if ( !ReadRecordHeader( offset, header ) )
+                    {
+                        return false;
+                    }
+
+                    if ( header.IsNull() )
+                    {
+                        break;
+                    }
+
+                    outChildren.emplace_back( header );
+                    offset = header.m_endOffset;
+                }
+
+                return true;
+            }
+
+            // Reads the headers of all the records in the file, depth first
+            bool ReadAllRecords( RecordHeader const* pParent, std::vector<RecordHeader>& outRecords )
+            {
+                std::vector<RecordHeader> children;
+                if ( !ReadChildRecords( pParent, children ) )
+                {
+                    return false;
+                }
+
+                for ( auto const& child : children )
+                {
+                    outRecords.emplace_back( child );
+                    if ( child.GetChildrenOffset() < child.m_endOffset && !ReadAllRecords( &child, outRecords ) )
+                    {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+        private:
+
+            FILE*                   m_pFile = nullptr;
+            uint64_t                m_fileSize = 0;
+            std::vector<char>       m_window;
+            uint64_t                m_windowOffset = 0;
+            bool                    m_isBinary = false;
+            bool                    m_is64Bit = false;
+        };
+
+        //-------------------------------------------------------------------------
+
+        // "Name\x00\x01Class" -> "Class::Name"
+        static std::string GetAsciiObjectName( std::string const& binaryName )
+        {
+            size_t const separatorIdx = binaryName.find( std::string( "\x00\x01", 2 ) );
+            if ( separatorIdx == std::string::npos )
+            {
+                return binaryName;
+            }
+
+            return binaryName.substr( separatorIdx + 2 ) + "::" + binaryName.substr( 0, separatorIdx );
+        }
+
+        static bool FindVideoRecords( BinaryFileReader& reader, std::vector<VideoRecord>& outVideos, std::string& errorMessage )
+        {
+            outVideos.clear();
+
+            std::vector<RecordHeader> topLevelRecords;
+            if ( !reader.ReadChildRecords( nullptr, topLevelRecords ) )
+            {
+                errorMessage = "corrupt binary file";
+                return false;
+            }
+
+            std::map<std::string, int> videoNameCounts;
+            for ( auto const& topLevelRecord : topLevelRecords )
+            {
+                if ( topLevelRecord.m_name != "Objects" )
+                {
+                    continue;
+                }
+
+                std::vector<RecordHeader> objectRecords;
+                if ( !reader.ReadChildRecords( &topLevelRecord, objectRecords ) )
+                {
+                    errorMessage = "corrupt binary file";
+                    return false;
+                }
+
+                for ( auto const& objectRecord : objectRecords )
+                {
+                    if ( objectRecord.m_name != "Video" )
+                    {
+                        continue;
+                    }
+
+                    // Video: ID, "Name\x00\x01Video", "Type"
+                    VideoRecord video;
+                    video.m_header = objectRecord;
+
+                    char type = 0;
+                    std::string stringValue;
+                    uint64_t dataOffset = 0, dataSize = 0;
+                    uint64_t propertyOffset = objectRecord.m_propertiesOffset;
+                    for ( uint64_t i = 0; i < std::min( objectRecord.m_numProperties, uint64_t( 2 ) ); i++ )
+                    {
+                        if ( !reader.ReadProperty( propertyOffset, type, stringValue, dataOffset, dataSize, propertyOffset ) )
+                        {
+                            errorMessage = "corrupt binary file";
+                            return false;
+                        }
+                    }
+
+                    video.m_name = ( type == 'S' ) ? GetAsciiObjectName( stringValue ) : std::string();
+                    video.m_index = videoNameCounts[video.m_name]++;
+
+                    //-------------------------------------------------------------------------
+
+                    std::vector<RecordHeader> videoRecords;
+                    if ( !reader.ReadChildRecords( &objectRecord, videoRecords ) )
+                    {
+                        errorMessage = "corrupt binary file";
+                        return false;
+                    }
+
+                    std::string fileName, relativeFileName;
+                    for ( auto const& videoRecord : videoRecords )
+                    {
+                        bool const isContent = videoRecord.m_name == g_contentRecordName;
+                        bool const isFileName = videoRecord.m_name == "Filename" || videoRecord.m_name == "FileName";
+                        bool const isRelativeFileName = videoRecord.m_name == "RelativeFilename" || videoRecord.m_name == "RelativeFileName";
+                        if ( ( !isContent && !isFileName && !isRelativeFileName ) || videoRecord.m_numProperties == 0 )
+                        {
+                            continue;
+                        }
+
+                        uint64_t nextOffset = 0;
+                        if ( !reader.ReadProperty( videoRecord.m_propertiesOffset, type, stringValue, dataOffset, dataSize, nextOffset ) )
+                        {
+                            errorMessage = "corrupt binary file";
+                            return false;
+                        }
+
+                        if ( isContent )
+                        {
+                            video.m_hasContent = true;
+                            video.m_contentHeader = videoRecord;
+                            if ( type == 'R' )
+                            {
+                                video.m_contentDataOffset = dataOffset;
+                                video.m_contentDataSize = dataSize;
+                            }
+                        }
+                        else if ( type == 'S' )
+                        {
+                            ( isFileName ? fileName : relativeFileName ) = stringValue;
+                        }
+                    }
+
+                    video.m_fileName = relativeFileName.empty() ? fileName : relativeFileName;
+                    outVideos.emplace_back( video );
+                }
+            }
+
+            return true;
+        }
+
+        //-------------------------------------------------------------------------
+
+        static bool CopyFileRange( FILE* pSourceFile, uint64_t offset, uint64_t size, FILE* pOutputFile, std::vector<char>& buffer )
+        {
+            if ( size == 0 )
+            {
+                return true;
+            }
+
+            if ( _fseeki64( pSourceFile, (int64_t) offset, SEEK_SET ) != 0 )
+            {
+                return false;
+            }
+
+            buffer.resize( g_copyBufferSize );
+            while ( size > 0 )
+            {
+                size_t const chunkSize = (size_t) std::min( size, (uint64_t) buffer.size() );
+                if ( fread( buffer.data(), 1, chunkSize, pSourceFile ) != chunkSize || fwrite( buffer.data(), 1, chunkSize, pOutputFile ) != chunkSize )
+                {
+                    return false;
+                }
+
+                size -= chunkSize;
+            }
+
+            return true;
+        }
+
+        template<typename T>
+        static void AppendValue( std::vector<char>& bytes, T value )
+        {
+            char const* pValue = reinterpret_cast<char const*>( &value );
+            bytes.insert( bytes.end(), pValue, pValue + sizeof( T ) );
+        }
+
+        static uint64_t GetContentRecordSize( bool is64Bit, uint64_t contentSize )
+        {
+            return ( is64Bit ? 25 : 13 ) + ( sizeof( g_contentRecordName ) - 1 ) + 5 + contentSize;
+        }
+
+        // Adds a splice that replaces the range with a "Content" record holding the blob (or an empty content if there is no blob)
+        static void AddContentRecordSplice( std::vector<Splice>& splices, bool is64Bit, uint64_t offset, uint64_t removedSize, MediaBlob const* pBlob )
+        {
+            Splice splice;
+            splice.m_offset = offset;
+            splice.m_removedSize = removedSize;
+            splice.m_insertedSize = GetContentRecordSize( is64Bit, ( pBlob != nullptr ) ? pBlob->m_contentSize : 0 );
+            splice.m_pBlob = pBlob;
+            splice.m_isContentRecord = true;
+            splices.emplace_back( splice );
+        }
+
+        // The footer after the top-level null record is a 16 byte id and 4 zero bytes, followed by zero padding up to the next 16 byte boundary
+        // (a full 16 bytes when already aligned), the version, 120 zero bytes and a 16 byte magic. Returns false if the footer doesn't have this layout.
+        static bool FindFooterPadding( BinaryFileReader& reader, std::vector<RecordHeader> const& records, uint64_t& paddingOffset, uint64_t& paddingSize )
+        {
+            uint64_t topLevelEndOffset = g_binaryHeaderSize;
+            for ( auto const& record : records )
+            {
+                topLevelEndOffset = std::max( topLevelEndOffset, record.m_endOffset );
+            }
+
+            uint64_t const footerTailSize = 4 + 120 + 16;
+            paddingOffset = topLevelEndOffset + reader.GetRecordHeaderSize() + 16 + 4;
+            if ( paddingOffset + footerTailSize > reader.GetFileSize() )
+            {
+                return false;
+            }
+
+            paddingSize = reader.GetFileSize() - footerTailSize - paddingOffset;
+            if ( paddingSize == 0 || paddingSize > 16 )
+            {
+                return false;
+            }
+
+            char padding[16];
+            char const zeros[16] = {};
+            return reader.ReadBytes( paddingOffset, padding, (size_t) paddingSize ) && memcmp( padding, zeros, (size_t) paddingSize ) == 0;
+        }
+
+        // Rewrites the file with the splices applied, the end offsets and property list lengths of all the records are updated to match
+        static bool WriteSplicedFile( BinaryFileReader& reader, MediaSource const& source, std::vector<Splice>& splices, std::string const& outputFilePath, std::string& errorMessage )
+        {
+            std::vector<RecordHeader> records;
+            if ( !reader.ReadAllRecords( nullptr, records ) )
+            {
+                errorMessage = "corrupt binary file";
+                return false;
+            }
+
+            std::sort( splices.begin(), splices.end(), [] ( Splice const& a, Splice const& b ) { return a.m_offset < b.m_offset; } );
+
+            // The splices never overlap, so we can use the running size change to map offsets from the original file to the new file
+            std::vector<uint64_t> spliceOffsets;
+            std::vector<int64_t> spliceDeltas( 1, 0 );
+            for ( auto const& splice : splices )
+            {
+                spliceOffsets.emplace_back( splice.m_offset );
+                spliceDeltas.emplace_back( spliceDeltas.back() + (int64_t) splice.m_insertedSize - (int64_t) splice.m_removedSize );
+            }
+
+            // Splices starting at the offset are not included, so the result is where the original data at that offset ends up
+            auto GetNewOffset = [&spliceOffsets, &spliceDeltas] ( uint64_t offset )
+            {
+                size_t const numSplicesBefore = std::lower_bound( spliceOffsets.begin(), spliceOffsets.end(), offset ) - spliceOffsets.begin();
+                return (uint64_t) ( (int64_t) offset + spliceDeltas[numSplicesBefore] );
+            };
+
+            bool const is64Bit = reader.Is64Bit();
+            uint64_t const newFileSize = GetNewOffset( reader.GetFileSize() );
+            if ( !is64Bit && newFileSize > UINT32_MAX )
+            {
+                errorMessage = "the output is too large for the file version (32-bit offsets)";
+                return false;
+            }
+
+            // Generate the content records, now that we know where they end up
+            //-------------------------------------------------------------------------
+
+            for ( auto& splice : splices )
+            {
+                if ( !splice.m_isContentRecord )
+                {
+                    continue;
+                }
+
+                uint64_t const contentSize = ( splice.m_pBlob != nullptr ) ? splice.m_pBlob->m_contentSize : 0;
+                uint64_t const endOffset = GetNewOffset( splice.m_offset ) + splice.m_insertedSize;
+                if ( is64Bit )
+                {
+                    AppendValue<uint64_t>( splice.m_bytes, endOffset );
+                    AppendValue<uint64_t>( splice.m_bytes, 1 );
+                    AppendValue<uint64_t>( splice.m_bytes, 5 + contentSize );
+                }
+                else
+                {
+                    AppendValue<uint32_t>( splice.m_bytes, (uint32_t) endOffset );
+                    AppendValue<uint32_t>( splice.m_bytes, 1 );
+                    AppendValue<uint32_t>( splice.m_bytes, (uint32_t) ( 5 + contentSize ) );
+                }
+
+                AppendValue<uint8_t>( splice.m_bytes, (uint8_t) ( sizeof( g_contentRecordName ) - 1 ) );
+                splice.m_bytes.insert( splice.m_bytes.end(), g_contentRecordName, g_contentRecordName + sizeof( g_contentRecordName ) - 1 );
+                AppendValue<char>( splice.m_bytes, 'R' );
+                AppendValue<uint32_t>( splice.m_bytes, (uint32_t) contentSize );
+            }
+
+            // Patch the headers of all the records that moved or changed size
+            //-------------------------------------------------------------------------
+
+            std::vector<Splice> headerPatches;
+            size_t const fieldSize = is64Bit ? 8 : 4;
+            for ( auto const& record : records )
+            {
+                // Skip records that are part of a replaced range
+                size_t const lastSpliceIdx = std::upper_bound( spliceOffsets.begin(), spliceOffsets.end(), record.m_offset ) - spliceOffsets.begin();
+                if ( lastSpliceIdx > 0 && record.m_offset < splices[lastSpliceIdx - 1].m_offset + splices[lastSpliceIdx - 1].m_removedSize )
+                {
+                    continue;
+                }
+
+                size_t const firstPropertySpliceIdx = std::lower_bound( spliceOffsets.begin(), spliceOffsets.end(), record.m_propertiesOffset ) - spliceOffsets.begin();
+                size_t const endPropertySpliceIdx = std::lower_bound( spliceOffsets.begin(), spliceOffsets.end(), record.GetChildrenOffset() ) - spliceOffsets.begin();
+                int64_t const propertyListDelta = spliceDeltas[endPropertySpliceIdx] - spliceDeltas[firstPropertySpliceIdx];
+
+                uint64_t const newEndOffset = GetNewOffset( record.m_endOffset );
+                if ( newEndOffset != record.m_endOffset )
+                {
+                    Splice patch;
+                    patch.m_offset = record.m_offset;
+                    patch.m_removedSize = patch.m_insertedSize = fieldSize;
+                    if ( is64Bit )
+                    {
+                        AppendValue<uint64_t>( patch.m_bytes, newEndOffset );
+                    }
+                    else
+                    {
+                        AppendValue<uint32_t>( patch.m_bytes, (uint32_t) newEndOffset );
+                    }
+                    headerPatches.emplace_back( patch );
+                }
+
+                if ( propertyListDelta != 0 )
+                {
+                    uint64_t const newPropertyListLength = (uint64_t) ( (int64_t) record.m_propertyListLength + propertyListDelta );
+                    Splice patch;
+                    patch.m_offset = record.m_offset + 2 * fieldSize;
+                    patch.m_removedSize = patch.m_insertedSize = fieldSize;
+                    if ( is64Bit )
+                    {
+                        AppendValue<uint64_t>( patch.m_bytes, newPropertyListLength );
+                    }
+                    else
+                    {
+                        AppendValue<uint32_t>( patch.m_bytes, (uint32_t) newPropertyListLength );
+                    }
+                    headerPatches.emplace_back( patch );
+                }
+            }
+
+            // The footer padding aligns the end of the file, so it changes whenever the size of the records does
+            uint64_t paddingOffset = 0, paddingSize = 0;
+            if ( FindFooterPadding( reader, records, paddingOffset, paddingSize ) )
+            {
+                uint64_t const newPaddingSize = 16 - ( GetNewOffset( paddingOffset ) % 16 );
+                if ( newPaddingSize != paddingSize )
+                {
+                    Splice patch;
+                    patch.m_offset = paddingOffset;
+                    patch.m_removedSize = paddingSize;
+                    patch.m_insertedSize = newPaddingSize;
+                    patch.m_bytes.resize( (size_t) newPaddingSize, 0 );
+                    headerPatches.emplace_back( patch );
+                }
+            }
+
+            splices.insert( splices.end(), headerPatches.begin(), headerPatches.end() );
+            std::stable_sort( splices.begin(), splices.end(), [] ( Splice const& a, Splice const& b ) { return a.m_offset < b.m_offset; } );
+
+            // Write the new file
+            //-------------------------------------------------------------------------
+
+            FILE* pMediaFile = nullptr;
+            bool const needsMediaFile = std::any_of( splices.begin(), splices.end(), [] ( Splice const& splice ) { return splice.m_pBlob != nullptr; } );
+            if ( needsMediaFile && fopen_s( &pMediaFile, source.m_filePath.c_str(), "rb" ) != 0 )
+            {
+                errorMessage = "failed to open media source file";
+                return false;
+            }
+
+            FILE* pOutputFile = nullptr;
+            if ( fopen_s( &pOutputFile, outputFilePath.c_str(), "wb" ) != 0 )
+            {
+                if ( pMediaFile != nullptr )
+                {
+                    fclose( pMediaFile );
+                }
+
+                errorMessage = "failed to open output file";
+                return false;
+            }
+
+            std::vector<char> buffer;
+            uint64_t cursor = 0;
+            bool succeeded = true;
+            for ( auto const& splice : splices )
+            {
+                succeeded = CopyFileRange( reader.GetFile(), cursor, splice.m_offset - cursor, pOutputFile, buffer );
+                succeeded = succeeded && fwrite( splice.m_bytes.data(), 1, splice.m_bytes.size(), pOutputFile ) == splice.m_bytes.size();
+                if ( succeeded && splice.m_pBlob != nullptr )
+                {
+                    succeeded = CopyFileRange( pMediaFile, splice.m_pBlob->m_contentOffset, splice.m_pBlob->m_contentSize, pOutputFile, buffer );
+                }
+
+                if ( !succeeded )
+                {
+                    break;
+                }
+
+                cursor = splice.m_offset + splice.m_removedSize;
+            }
+
+            succeeded = succeeded && CopyFileRange( reader.GetFile(), cursor, reader.GetFileSize() - cursor, pOutputFile, buffer );
+
+            if ( pMediaFile != nullptr )
+            {
+                fclose( pMediaFile );
+            }
+
+            fclose( pOutputFile );
+
+            if ( !succeeded )
+            {
+                errorMessage = "failed to write output file";
+                remove( outputFilePath.c_str() );
+            }
+
+            return succeeded;
+        }
+
+        //-------------------------------------------------------------------------
+
+        static bool WriteBinaryFileWithMedia( BinaryFileReader& reader, MediaSource const& source, std::string const& outputFilePath, std::string& errorMessage )
+        {
+            std::vector<VideoRecord> videos;
+            if ( !FindVideoRecords( reader, videos, errorMessage ) )
+            {
+                return false;
+            }
+
+            std::vector<Splice> splices;
+            for ( auto const& video : videos )
+            {
+                MediaBlob const* pBlob = FindBlob( source, video.m_name, video.m_index );
+                if ( pBlob == nullptr )
+                {
+                    continue;
+                }
+
+                // Replace the existing content, otherwise add the content as the last child (just before the null record that ends the child list)
+                if ( video.m_hasContent )
+                {
+                    AddContentRecordSplice( splices, reader.Is64Bit(), video.m_contentHeader.m_offset, video.m_contentHeader.m_endOffset - video.m_contentHeader.m_offset, pBlob );
+                }
+                else
+                {
+                    RecordHeader nullRecord;
+                    uint64_t const nullRecordOffset = video.m_header.m_endOffset - reader.GetRecordHeaderSize();
+                    if ( video.m_header.GetChildrenOffset() >= video.m_header.m_endOffset || !reader.ReadRecordHeader( nullRecordOffset, nullRecord ) || !nullRecord.IsNull() )
+                    {
+                        errorMessage = "unexpected video record layout ( " + video.m_name + " )";
+                        return false;
+                    }
+
+                    AddContentRecordSplice( splices, reader.Is64Bit(), nullRecordOffset, 0, pBlob );
+                }
+            }
+
+            return WriteSplicedFile( reader, source, splices, outputFilePath, errorMessage );
+        }
+
+        //-------------------------------------------------------------------------
+
+        static bool ReadLine( FILE* pFile, std::string& line )
+        {
+            line.clear();
+
+            char buffer[64 * 1024];
+            while ( fgets( buffer, sizeof( buffer ), pFile ) != nullptr )
+            {
+                line += buffer;
+                if ( !line.empty() && line.back() == '\n' )
+                {
+                    return true;
+                }
+            }
+
+            return !line.empty();
+        }
+
+        // Writes the content as base64 split into lines of g_base64LineLength characters, the separator is written between the lines
+        static bool WriteBase64( FILE* pMediaFile, MediaBlob const& blob, std::string const& lineSeparator, FILE* pOutputFile )
+        {
+            static char const s_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+            if ( _fseeki64( pMediaFile, (int64_t) blob.m_contentOffset, SEEK_SET ) != 0 )
+            {
+                return false;
+            }
+
+            // The chunk size is a multiple of the bytes per line (itself a multiple of 3), so padding is only ever needed for the last chunk
+            // and the lines never straddle chunks
+            size_t const lineInputSize = g_base64LineLength / 4 * 3;
+            size_t const chunkSize = lineInputSize * 8 * 1024;
+            std::vector<unsigned char> input( chunkSize );
+            std::vector<char> output( chunkSize / 3 * 4 + chunkSize / lineInputSize * lineSeparator.length() );
+
+            uint64_t remainingSize = blob.m_contentSize;
+            while ( remainingSize > 0 )
+            {
+                size_t const readSize = (size_t) std::min( remainingSize, (uint64_t) chunkSize );
+                if ( fread( input.data(), 1, readSize, pMediaFile ) != readSize )
+                {
+                    return false;
+                }
+
+                bool const isFirstChunk = remainingSize == blob.m_contentSize;
+                size_t outputSize = 0;
+                for ( size_t i = 0; i < readSize; i += 3 )
+                {
+                    if ( i % lineInputSize == 0 && ( i > 0 || !isFirstChunk ) )
+                    {
+                        memcpy( &output[outputSize], lineSeparator.data(), lineSeparator.length() );
+                        outputSize += lineSeparator.length();
+                    }
+
+                    uint32_t const numBytes = (uint32_t) std::min( readSize - i, size_t( 3 ) );
+                    uint32_t const value = ( input[i] << 16 ) | ( ( numBytes > 1 ? input[i + 1] : 0 ) << 8 ) | ( numBytes > 2 ? input[i + 2] : 0 );
+                    output[outputSize++] = s_alphabet[( value >> 18 ) & 0x3F];
+                    output[outputSize++] = s_alphabet[( value >> 12 ) & 0x3F];
+                    output[outputSize++] = ( numBytes > 1 ) ? s_alphabet[( value >> 6 ) & 0x3F] : '=';
+                    output[outputSize++] = ( numBytes > 2 ) ? s_alphabet[value & 0x3F] : '=';
+                }
+
+                if ( fwrite( output.data(), 1, outputSize, pOutputFile ) != outputSize )
+                {
+                    return false;
+                }
+
+                remainingSize -= readSize;
+            }
+
+            return true;
+        }
+
+        // Returns the node name of an ascii line, i.e. "Content" for "    Content: , ..."
+        static std::string GetAsciiNodeName( std::string const& line )
+        {
+            size_t const startIdx = line.find_first_not_of( " \t" );
+            if ( startIdx == std::string::npos || line[startIdx] == ';' )
+            {
+                return std::string();
+            }
+
+            size_t const separatorIdx = line.find( ':', startIdx );
+            if ( separatorIdx == std::string::npos )
+            {
+                return std::string();
+            }
+
+            return line.substr( startIdx, separatorIdx - startIdx );
+        }
+
+        // Returns the first quoted string of the line, i.e. the name of an object: Video: 123, "Video::Name", "Clip" {
+        static std::string GetAsciiLineObjectName( std::string const& line )
+        {
+            size_t const startIdx = line.find( '"' );
+            size_t const endIdx = ( startIdx != std::string::npos ) ? line.find( '"', startIdx + 1 ) : std::string::npos;
+            if ( endIdx == std::string::npos )
+            {
+                return std::string();
+            }
+
+            return line.substr( startIdx + 1, endIdx - startIdx - 1 );
+        }
+
+        static bool WriteAsciiFileWithMedia( MediaSource const& source, std::string const& exportedFilePath, std::string const& outputFilePath, std::string& errorMessage )
+        {
+            FILE* pExportedFile = nullptr;
+            if ( fopen_s( &pExportedFile, exportedFilePath.c_str(), "rb" ) != 0 )
+            {
+                errorMessage = "failed to open exported file";
+                return false;
+            }
+
+            FILE* pMediaFile = nullptr;
+            if ( fopen_s( &pMediaFile, source.m_filePath.c_str(), "rb" ) != 0 )
+            {
+                fclose( pExportedFile );
+                errorMessage = "failed to open media source file";
+                return false;
+            }
+
+            FILE* pOutputFile = nullptr;
+            if ( fopen_s( &pOutputFile, outputFilePath.c_str(), "wb" ) != 0 )
+            {
+                fclose( pExportedFile );
+                fclose( pMediaFile );
+                errorMessage = "failed to open output file";
+                return false;
+            }
+
+            //-------------------------------------------------------------------------
+
+            std::vector<std::string> nodeStack;
+            std::map<std::string, int> videoNameCounts;
+            MediaBlob const* pCurrentBlob = nullptr;
+            std::string currentIndent;
+            bool isSkippingContent = false;
+            bool succeeded = true;
+
+            std::string line;
+            while ( succeeded && ReadLine( pExportedFile, line ) )
+            {
+                std::string const nodeName = GetAsciiNodeName( line );
+                bool const isInVideo = nodeStack.size() == 2 && nodeStack[0] == "Objects" && nodeStack[1] == "Video";
+                size_t const firstCharIdx = line.find_first_not_of( " \t\r\n" );
+                char const firstChar = ( firstCharIdx != std::string::npos ) ? line[firstCharIdx] : 0;
+
+                // Drop any existing content (including its continuation lines) from the videos we have media for
+                if ( isInVideo && pCurrentBlob != nullptr )
+                {
+                    if ( nodeName == g_contentRecordName )
+                    {
+                        isSkippingContent = true;
+                        continue;
+                    }
+
+                    if ( isSkippingContent && ( firstChar == '"' || firstChar == ',' ) )
+                    {
+                        continue;
+                    }
+
+                    isSkippingContent = false;
+
+                    // Add the content as the last child of the video, each line of base64 is its own string like the SDK writes it
+                    if ( firstChar == '}' )
+                    {
+                        std::string const lineSeparator = "\"\n" + currentIndent + ",\"";
+                        succeeded = fprintf( pOutputFile, "%sContent: , \"", currentIndent.c_str() ) > 0;
+                        succeeded = succeeded && WriteBase64( pMediaFile, *pCurrentBlob, lineSeparator, pOutputFile );
+                        succeeded = succeeded && fprintf( pOutputFile, "\"\n" ) > 0;
+                        pCurrentBlob = nullptr;
+                    }
+                }
+
+                if ( nodeStack.size() == 1 && nodeStack[0] == "Objects" && nodeName == "Video" )
+                {
+                    std::string const videoName = GetAsciiLineObjectName( line );
+                    pCurrentBlob = FindBlob( source, videoName, videoNameCounts[videoName]++ );
+                    currentIndent = line.substr( 0, line.find_first_not_of( " \t" ) ) + "\t";
+                }
+
+                // Track the node hierarchy, ignoring braces inside strings
+                bool isInString = false;
+                for ( char const c : line )
+                {
+                    if ( c == '"' )
+                    {
+                        isInString = !isInString;
+                    }
+                    else if ( !isInString && c == '{' )
+                    {
+                        nodeStack.emplace_back( nodeName );
+                    }
+                    else if ( !isInString && c == '}' && !nodeStack.empty() )
+                    {
+                        nodeStack.pop_back();
+                    }
+                }
+
+                succeeded = succeeded && fwrite( line.data(), 1, line.size(), pOutputFile ) == line.size();
+            }
+
+            fclose( pExportedFile );
+            fclose( pMediaFile );
+            fclose( pOutputFile );
+
+            if ( !succeeded )
+            {
+                errorMessage = "failed to write output file";
+                remove( outputFilePath.c_str() );
+            }
+
+            return succeeded;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+
+    bool ParseMode( std::string const& modeString, Mode& outMode )
+    {
+        if ( _stricmp( modeString.c_str(), "stream" ) == 0 )
+        {
+            outMode = Mode::Stream;
+            return true;
+        }
+
+        if ( _stricmp( modeString.c_str(), "extract" ) == 0 )
+        {
+            outMode = Mode::Extract;
+            return true;
+        }
+
+        return false;
+    }
+
+    MediaBlob const* FindBlob( MediaSource const& source, std::string const& videoName, int videoIndex )
+    {
+        for ( auto const& blob : source.m_blobs )
+        {
+            if ( blob.m_videoName == videoName && blob.m_videoIndex == videoIndex )
+            {
+                return &blob;
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool FindMedia( std::string const& filePath, std::vector<MediaBlob>& outBlobs, std::string& errorMessage )
+    {
+        outBlobs.clear();
+
+        BinaryFileReader reader;
+        if ( !reader.Open( filePath, errorMessage ) )
+        {
+            return false;
+        }
+
+        if ( !reader.IsBinary() )
+        {
+            return true;
+        }
+
+        std::vector<VideoRecord> videos;
+        if ( !FindVideoRecords( reader, videos, errorMessage ) )
+        {
+            return false;
+        }
+
+        for ( auto const& video : videos )
+        {
+            if ( video.m_contentDataSize == 0 )
+            {
+                continue;
+            }
+
+            MediaBlob blob;
+            blob.m_videoName = video.m_name;
+            blob.m_videoIndex = video.m_index;
+            blob.m_fileName = video.m_fileName;
+            blob.m_contentOffset = video.m_contentDataOffset;
+            blob.m_contentSize = video.m_contentDataSize;
+            outBlobs.emplace_back( blob );
+        }
+
+        return true;
+    }
+
+    bool WriteFileWithoutMedia( MediaSource const& source, std::string const& outputFilePath, std::string& errorMessage )
+    {
+        BinaryFileReader reader;
+        if ( !reader.Open( source.m_filePath, errorMessage ) )
+        {
+            return false;
+        }
+
+        if ( !reader.IsBinary() )
+        {
+            errorMessage = "not a binary file";
+            return false;
+        }
+
+        std::vector<VideoRecord> videos;
+        if ( !FindVideoRecords( reader, videos, errorMessage ) )
+        {
+            return false;
+        }
+
+        // Replace the content records with empty ones, rather than removing them, so the videos are still flagged as having had content
+        std::vector<Splice> splices;
+        for ( auto const& video : videos )
+        {
+            if ( video.m_contentDataSize > 0 )
+            {
+                AddContentRecordSplice( splices, reader.Is64Bit(), video.m_contentHeader.m_offset, video.m_contentHeader.m_endOffset - video.m_contentHeader.m_offset, nullptr );
+            }
+        }
+
+        return WriteSplicedFile( reader, source, splices, outputFilePath, errorMessage );
+    }
+
+    bool WriteFileWithMedia( MediaSource const& source, std::string const& exportedFilePath, std::string const& outputFilePath, std::string& errorMessage )
+    {
+        BinaryFileReader reader;
+        if ( !reader.Open( exportedFilePath, errorMessage ) )
+        {
+            return false;
+        }
+
+        if ( reader.IsBinary() )
+        {
+            return WriteBinaryFileWithMedia( reader, source, outputFilePath, errorMessage );
+        }
+
+        return WriteAsciiFileWithMedia( source, exportedFilePath, outputFilePath, errorMessage );
+    }
+
+    bool ExtractBlob( MediaSource const& source, MediaBlob const& blob, std::string const& outputFilePath, std::string& errorMessage )
+    {
+        FILE* pMediaFile = nullptr;
+        if ( fopen_s( &pMediaFile, source.m_filePath.c_str(), "rb" ) != 0 )
+        {
+            errorMessage = "failed to open media source file";
+            return false;
+        }
+
+        FILE* pOutputFile = nullptr;
+        if ( fopen_s( &pOutputFile, outputFilePath.c_str(), "wb" ) != 0 )
+        {
+            fclose( pMediaFile );
+            errorMessage = "failed to open output file";
+            return false;
+        }
+
+        std::vector<char> buffer;
+        bool const succeeded = CopyFileRange( pMediaFile, blob.m_contentOffset, blob.m_contentSize, pOutputFile, buffer );
+        fclose( pMediaFile );
+        fclose( pOutputFile );
+
+        if ( !succeeded )
+        {
+            errorMessage = "failed to write output file";
+            remove( outputFilePath.c_str() );
+        }
+
+        return succeeded;
+    }
+
+    std::string GetMediaFolderPath( std::string const& outputFilePath )
+    {
+        std::string folderPath = outputFilePath;
+        size_t const extensionIdx = folderPath.find_last_of( '.' );
+        size_t const separatorIdx = folderPath.find_last_of( "\\/" );
+        if ( extensionIdx != std::string::npos && ( separatorIdx == std::string::npos || extensionIdx > separatorIdx ) )
+        {
+            folderPath.resize( extensionIdx );
+        }
+
+        return folderPath + ".fbm";
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------
+// Streaming of the media (textures, video) embedded in binary FBX files.
+// The embedded content is stored as a raw property on the "Video" objects and can be hundreds of MBs, loading it through the SDK
+// means holding it in memory and copying it around several times. Instead we strip the content from the file before import, and
+// once the scene has been exported we stream it straight from the source file into the output (or into side files), in chunks.
+//-------------------------------------------------------------------------
+
+namespace EmbeddedMedia
+{
+    enum class Mode
+    {
+        Stream,     // Stream the content back into the output file
+        Extract,    // Write the content to files next to the output file and reference them
+    };
+
+    // Valid modes are "stream" and "extract"
+    bool ParseMode( std::string const& modeString, Mode& outMode );
+
+    //-------------------------------------------------------------------------
+
+    struct MediaBlob
+    {
+        std::string                 m_videoName;            // In the ascii form, i.e. "Video::Name"
+        int                         m_videoIndex = 0;       // The index of this video amongst the videos with the same name
+        std::string                 m_fileName;             // The relative filename (or filename) of the video
+        uint64_t                    m_contentOffset = 0;    // The offset of the content data in the source file
+        uint64_t                    m_contentSize = 0;
+    };
+
+    struct MediaSource
+    {
+        inline bool HasMedia() const { return !m_blobs.empty(); }
+
+    public:
+
+        std::string                 m_filePath;
+        bool                        m_isTemporaryFile = false;
+        std::vector<MediaBlob>      m_blobs;
+    };
+
+    // Returns the blob of the specified video, or null if the video has no embedded content
+    MediaBlob const* FindBlob( MediaSource const& source, std::string const& videoName, int videoIndex );
+
+    //-------------------------------------------------------------------------
+
+    // Finds all the embedded video content in a binary file, ascii files never contain any streamable media
+    bool FindMedia( std::string const& filePath, std::vector<MediaBlob>& outBlobs, std::string& errorMessage );
+
+    // Writes a copy of the source file with all the embedded content removed
+    bool WriteFileWithoutMedia( MediaSource const& source, std::string const& outputFilePath, std::string& errorMessage );
+
+    // Writes a copy of an exported (binary or ascii) file with the content of the source media added back into the matching videos
+    bool WriteFileWithMedia( MediaSource const& source, std::string const& exportedFilePath, std::string const& outputFilePath, std::string& errorMessage );
+
+    // Writes the content of a single blob to its own file
+    bool ExtractBlob( MediaSource const& source, MediaBlob const& blob, std::string const& outputFilePath, std::string& errorMessage );
+
+    // "c:\out\kit.fbx" -> "c:\out\kit.fbm", the same naming the SDK uses when it extracts media
+    std::string GetMediaFolderPath( std::string const& outputFilePath );
+}
@@ -0,0 +1,748 @@
+#pragma once
+
+#include "FbxRawStream.h"
+#include "ZlibApi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------
+// Internal to the FbxRaw readers.
+// Decoding of the individual records, properties and values of both formats, shared by the Document parser and the StreamReader so that
+// they accept the same files and report the same errors. Walking the node tree is left to the readers.
+//-------------------------------------------------------------------------
+
+namespace FbxRaw
+{
+    namespace Lexer
+    {
+        static char const g_binaryMagic[] = "Kaydara FBX Binary  ";
+        static size_t const g_binaryHeaderSize = 27;
+
+        template<typename T>
+        inline T ReadValue( char const* pData )
+        {
+            T value;
+            memcpy( &value, pData, sizeof( T ) );
+            return value;
+        }
+
+        inline bool HasBinaryMagic( char const* pData, size_t dataSize )
+        {
+            return dataSize >= sizeof( g_binaryMagic ) && memcmp( pData, g_binaryMagic, sizeof( g_binaryMagic ) ) == 0;
+        }
+
+        inline size_t GetArrayElementSize( PropertyType type )
+        {
+            switch ( type )
+            {
+                case PropertyType::BoolArray: return 1;
+                case PropertyType::Int32Array: return 4;
+                case PropertyType::Int64Array: return 8;
+                case PropertyType::FloatArray: return 4;
+                case PropertyType::DoubleArray: return 8;
+                default: return 0;
+            }
+        }
+
+        // Binary files store object names as "Name\x00\x01Class" while ascii files store them as "Class::Name"
+        inline std::string ConvertBinaryObjectName( TextView name )
+        {
+            std::string str = name.ToString();
+            size_t const separatorIdx = str.find( std::string( "\x00\x01", 2 ) );
+            if ( separatorIdx != std::string::npos )
+            {
+                str = str.substr( separatorIdx + 2 ) + "::" + str.substr( 0, separatorIdx );
+            }
+
+            return str;
+        }
+
+        inline bool IsAsciiIdentifierChar( char c )
+        {
+            return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' ) || c == '_' || c == '|' || c == '-' || c == '.';
+        }
+
+        inline bool IsAsciiNumberChar( char c )
+        {
+            return ( c >= '0' && c <= '9' ) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+        }
+
+        //-------------------------------------------------------------------------
+        // Binary
+        //-------------------------------------------------------------------------
+
+        struct RecordHeader
+        {
+            uint64_t                m_offset = 0;
+            uint64_t                m_endOffset = 0;                // Null records end right after their header
+            uint64_t                m_numProperties = 0;
+            uint64_t                m_propertiesOffset = 0;
+            uint64_t                m_propertiesEndOffset = 0;
+            TextView                m_name;
+            bool                    m_isNull = false;
+        };
+
+        // The values of an array property, as stored in the file
+        struct EncodedArray
+        {
+            char const*             m_pData = nullptr;
+            uint32_t                m_encodedLength = 0;
+            uint32_t                m_encoding = 0;                 // 0: uncompressed, 1: deflate
+        };
+
+        class BinaryLexer
+        {
+        public:
+
+            BinaryLexer( char const* pData, size_t dataSize, uint32_t version, std::string& errorMessage )
+                : m_pData( pData )
+                , m_dataSize( dataSize )
+                , m_version( version )
+                , m_errorMessage( errorMessage )
+            {}
+
+            inline uint64_t GetRecordHeaderSize() const { return ( m_version >= 7500 ) ? 25 : 13; }
+
+            bool SetError( uint64_t offset, char const* pMessage )
+            {
+                char buffer[256];
+                snprintf( buffer, sizeof( buffer ), "%s (offset %llu)", pMessage, (unsigned long long) offset );
+                m_errorMessage = buffer;
+                return false;
+            }
+
+            // Reads the header of the record at the offset, the record needs to end within its parent
+            bool ReadRecordHeader( uint64_t offset, uint64_t parentEndOffset, RecordHeader& header )
+            {
+                uint64_t const recordHeaderSize = GetRecordHeaderSize();
+                if ( offset + recordHeaderSize > m_dataSize )
+                {
+                    return SetError( offset, "truncated node record" );
+                }
+
+                bool const is64Bit = m_version >= 7500;
+                char const* pRecord = m_pData + offset;
+                uint64_t const endOffset = is64Bit ? ReadValue<uint64_t>( pRecord ) : ReadValue<uint32_t>( pRecord );
+                uint64_t const numProperties = is64Bit ? ReadValue<uint64_t>( pRecord + 8 ) : ReadValue<uint32_t>( pRecord + 4 );
+                uint64_t const propertyListLength = is64Bit ? ReadValue<uint64_t>( pRecord + 16 ) : ReadValue<uint32_t>( pRecord + 8 );
+                uint8_t const nameLength = ReadValue<uint8_t>( pRecord + recordHeaderSize - 1 );
+
+                header = RecordHeader();
+                header.m_offset = offset;
+                header.m_isNull = ( endOffset == 0 );
+                if ( header.m_isNull )
+                {
+                    header.m_endOffset = offset + recordHeaderSize;
+                    header.m_propertiesOffset = header.m_propertiesEndOffset = header.m_endOffset;
+                    return true;
+                }
+
+                uint64_t const propertiesOffset = offset + recordHeaderSize + nameLength;
+                if ( endOffset > std::min( parentEndOffset, uint64_t( m_dataSize ) ) || endOffset < propertiesOffset + propertyListLength )
+                {
+                    return SetError( offset, "invalid node record end offset" );
+                }
+
+                header.m_endOffset = endOffset;
+                header.m_numProperties = numProperties;
+                header.m_propertiesOffset = propertiesOffset;
+                header.m_propertiesEndOffset = propertiesOffset + propertyListLength;
+                header.m_name.m_pData = pRecord + recordHeaderSize;
+                header.m_name.m_length = nameLength;
+                return true;
+            }
+
+            // Checks that the properties of the record ended where the header said they would
+            bool EndProperties( uint64_t recordOffset, uint64_t propertiesEndOffset, uint64_t cursor )
+            {
+                return ( cursor == propertiesEndOffset ) ? true : SetError( recordOffset, "property list length mismatch" );
+            }
+
+            // Reads the property at the cursor. Strings are views into the data, the values of arrays are only located and need to be decoded with DecodeArray.
+            bool ReadProperty( uint64_t& cursor, uint64_t endOffset, PropertyView& property, EncodedArray& encodedArray )
+            {
+                if ( cursor + 1 > endOffset )
+                {
+                    return SetError( cursor, "truncated property" );
+                }
+
+                property = PropertyView();
+                property.m_type = (PropertyType) m_pData[cursor];
+                cursor++;
+
+                char const* pValue = m_pData + cursor;
+                switch ( property.m_type )
+                {
+                    case PropertyType::Bool:
+                    return ReadScalar<uint8_t>( cursor, endOffset, property.m_int );
+
+                    case PropertyType::Int16:
+                    return ReadScalar<int16_t>( cursor, endOffset, property.m_int );
+
+                    case PropertyType::Int32:
+                    return ReadScalar<int32_t>( cursor, endOffset, property.m_int );
+
+                    case PropertyType::Int64:
+                    return ReadScalar<int64_t>( cursor, endOffset, property.m_int );
+
+                    case PropertyType::Float:
+                    return ReadScalar<float>( cursor, endOffset, property.m_float );
+
+                    case PropertyType::Double:
+                    return ReadScalar<double>( cursor, endOffset, property.m_float );
+
+                    case PropertyType::String:
+                    case PropertyType::Raw:
+                    {
+                        if ( cursor + 4 > endOffset )
+                        {
+                            return SetError( cursor, "truncated string property" );
+                        }
+
+                        uint32_t const length = ReadValue<uint32_t>( pValue );
+                        if ( cursor + 4 + length > endOffset )
+                        {
+                            return SetError( cursor, "truncated string property" );
+                        }
+
+                        property.m_string.m_pData = pValue + 4;
+                        property.m_string.m_length = length;
+                        cursor += 4 + length;
+                        return true;
+                    }
+
+                    case PropertyType::BoolArray:
+                    case PropertyType::Int32Array:
+                    case PropertyType::Int64Array:
+                    case PropertyType::FloatArray:
+                    case PropertyType::DoubleArray:
+                    {
+                        if ( cursor + 12 > endOffset )
+                        {
+                            return SetError( cursor, "truncated array property" );
+                        }
+
+                        uint32_t const arrayLength = ReadValue<uint32_t>( pValue );
+                        encodedArray.m_encoding = ReadValue<uint32_t>( pValue + 4 );
+                        encodedArray.m_encodedLength = ReadValue<uint32_t>( pValue + 8 );
+                        cursor += 12;
+
+                        if ( cursor + encodedArray.m_encodedLength > endOffset )
+                        {
+                            return SetError( cursor, "truncated array property" );
+                        }
+
+                        if ( encodedArray.m_encoding == 0 && encodedArray.m_encodedLength != uint64_t( arrayLength ) * GetArrayElementSize( property.m_type ) )
+                        {
+                            return SetError( cursor, "array length mismatch" );
+                        }
+
+                        if ( encodedArray.m_encoding > 1 )
+                        {
+                            return SetError( cursor, "unknown array encoding" );
+                        }
+
+                        property.m_arraySize = arrayLength;
+                        encodedArray.m_pData = m_pData + cursor;
+                        cursor += encodedArray.m_encodedLength;
+                        return true;
+                    }
+
+                    default:
+                    return SetError( cursor - 1, "unknown property type" );
+                }
+            }
+
+            // Uncompressed arrays are returned as a view into the data, compressed ones are decompressed into the buffer
+            bool DecodeArray( PropertyView const& property, EncodedArray const& encodedArray, std::vector<char>& buffer, ArrayView& outArray )
+            {
+                outArray.m_type = property.m_type;
+                outArray.m_size = property.m_arraySize;
+
+                if ( encodedArray.m_encoding == 0 )
+                {
+                    outArray.m_pData = encodedArray.m_pData;
+                    return true;
+                }
+
+                // Deflate can't expand data by more than ~1032:1, so a corrupt length can be rejected before we allocate anything for it
+                uint64_t const dataOffset = uint64_t( encodedArray.m_pData - m_pData );
+                uint64_t const decodedLength = uint64_t( property.m_arraySize ) * GetArrayElementSize( property.m_type );
+                if ( decodedLength > uint64_t( encodedArray.m_encodedLength ) * 1032 + 64 )
+                {
+                    return SetError( dataOffset, "failed to decompress array" );
+                }
+
+                buffer.resize( (size_t) decodedLength );
+
+                unsigned long destLength = (unsigned long) decodedLength;
+                int const result = uncompress( (unsigned char*) buffer.data(), &destLength, (unsigned char const*) encodedArray.m_pData, encodedArray.m_encodedLength );
+                if ( result != Zlib::s_resultOK || destLength != decodedLength )
+                {
+                    return SetError( dataOffset, "failed to decompress array" );
+                }
+
+                outArray.m_pData = buffer.data();
+                return true;
+            }
+
+        private:
+
+            template<typename T, typename V>
+            bool ReadScalar( uint64_t& cursor, uint64_t endOffset, V& value )
+            {
+                if ( cursor + sizeof( T ) > endOffset )
+                {
+                    return SetError( cursor, "truncated property" );
+                }
+
+                value = (V) ReadValue<T>( m_pData + cursor );
+                cursor += sizeof( T );
+                return true;
+            }
+
+        private:
+
+            char const*             m_pData = nullptr;
+            size_t const            m_dataSize = 0;
+            uint32_t const          m_version = 0;
+            std::string&            m_errorMessage;
+        };
+
+        //-------------------------------------------------------------------------
+        // Ascii
+        //-------------------------------------------------------------------------
+
+        class AsciiLexer
+        {
+        public:
+
+            // Lexes a range of the file, the file start is only needed for the line numbers in the error messages
+            AsciiLexer( char const* pFileStart, char const* pRangeStart, char const* pRangeEnd, std::string& errorMessage )
+                : m_pStart( pFileStart )
+                , m_pCurrent( pRangeStart )
+                , m_pEnd( pRangeEnd )
+                , m_errorMessage( errorMessage )
+            {}
+
+            inline char const* GetCurrent() const { return m_pCurrent; }
+            inline bool IsAtEnd() const { return m_pCurrent == m_pEnd; }
+            inline char Peek() const { return ( m_pCurrent < m_pEnd ) ? *m_pCurrent : 0; }
+
+            bool SetError( char const* pMessage )
+            {
+                int lineNumber = 1;
+                for ( char const* pChar = m_pStart; pChar < m_pCurrent; pChar++ )
+                {
+                    lineNumber += ( *pChar == '\n' ) ? 1 : 0;
+                }
+
+                char buffer[256];
+                snprintf( buffer, sizeof( buffer ), "%s (line %d)", pMessage, lineNumber );
+                m_errorMessage = buffer;
+                return false;
+            }
+
+            void SkipInlineWhitespace()
+            {
+                while ( m_pCurrent < m_pEnd && ( *m_pCurrent == ' ' || *m_pCurrent == '\t' || *m_pCurrent == '\r' ) )
+                {
+                    m_pCurrent++;
+                }
+            }
+
+            void SkipWhitespaceAndComments()
+            {
+                while ( m_pCurrent < m_pEnd )
+                {
+                    char const c = *m_pCurrent;
+                    if ( c == ' ' || c == '\t' || c == '\r' || c == '\n' )
+                    {
+                        m_pCurrent++;
+                    }
+                    else if ( c == ';' )
+                    {
+                        char const* pLineEnd = (char const*) memchr( m_pCurrent, '\n', m_pEnd - m_pCurrent );
+                        m_pCurrent = ( pLineEnd != nullptr ) ? pLineEnd : m_pEnd;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                }
+            }
+
+            // Reads "Name:", hasValues is set if the values of the node start on the same line
+            bool ReadNodeName( TextView& name, bool& hasValues )
+            {
+                char const* pNameStart = m_pCurrent;
+                while ( m_pCurrent < m_pEnd && IsAsciiIdentifierChar( *m_pCurrent ) )
+                {
+                    m_pCurrent++;
+                }
+
+                if ( Peek() != ':' || m_pCurrent == pNameStart )
+                {
+                    return SetError( "expected node name" );
+                }
+
+                name.m_pData = pNameStart;
+                name.m_length = m_pCurrent - pNameStart;
+                m_pCurrent++;
+
+                SkipInlineWhitespace();
+                char const c = Peek();
+                hasValues = ( c != '\n' && c != '{' && c != '}' && !IsAtEnd() );
+                return true;
+            }
+
+            // Values are comma separated and may continue on the following line if the line ends (or the next one starts) with a comma.
+            // This steps over the comma after a value and returns false once the values have run out.
+            bool SkipValueSeparator()
+            {
+                SkipInlineWhitespace();
+                if ( Peek() != ',' )
+                {
+                    char const* pLineEnd = m_pCurrent;
+                    SkipWhitespaceAndComments();
+                    if ( Peek() != ',' )
+                    {
+                        m_pCurrent = pLineEnd;
+                        return false;
+                    }
+                }
+
+                m_pCurrent++;
+                SkipWhitespaceAndComments();
+                return !IsAtEnd();
+            }
+
+            // Reads the opening brace of the child list once the values have been read, returns false if the node has no children
+            bool ReadChildListStart()
+            {
+                SkipInlineWhitespace();
+                if ( Peek() != '{' )
+                {
+                    return false;
+                }
+
+                m_pCurrent++;
+                return true;
+            }
+
+            // Moves to the next child of a child list, isListEnd is set once the closing brace has been read instead
+            bool NextChild( bool& isListEnd )
+            {
+                SkipWhitespaceAndComments();
+                if ( IsAtEnd() )
+                {
+                    return SetError( "unexpected end of file, missing '}'" );
+                }
+
+                isListEnd = ( *m_pCurrent == '}' );
+                if ( isListEnd )
+                {
+                    m_pCurrent++;
+                }
+
+                return true;
+            }
+
+            // Finds the brace closing the current child list, strings and comments are skipped since they can contain braces
+            bool SkipChildList()
+            {
+                int depth = 1;
+                while ( m_pCurrent < m_pEnd )
+                {
+                    char const c = *m_pCurrent;
+                    if ( c == '"' )
+                    {
+                        char const* pStringEnd = (char const*) memchr( m_pCurrent + 1, '"', m_pEnd - m_pCurrent - 1 );
+                        if ( pStringEnd == nullptr )
+                        {
+                            return SetError( "unterminated string" );
+                        }
+
+                        m_pCurrent = pStringEnd + 1;
+                    }
+                    else if ( c == ';' )
+                    {
+                        SkipWhitespaceAndComments();
+                    }
+                    else
+                    {
+                        m_pCurrent++;
+                        depth += ( c == '{' ) ? 1 : ( c == '}' ) ? -1 : 0;
+                        if ( depth == 0 )
+                        {
+                            return true;
+                        }
+                    }
+                }
+
+                return SetError( "unexpected end of file, missing '}'" );
+            }
+
+            // Reads a value, empty values (i.e. "Content: ,") need to be checked for beforehand. Strings are views into the data.
+            // Arrays (*<count> { a: <values> }) are only read up to their values, which then need to be read with ReadArrayValues or skipped with SkipArrayValues.
+            bool ReadProperty( PropertyView& property )
+            {
+                property = PropertyView();
+                char const c = Peek();
+
+                // String
+                if ( c == '"' )
+                {
+                    char const* pStringStart = ++m_pCurrent;
+                    char const* pStringEnd = (char const*) memchr( pStringStart, '"', m_pEnd - pStringStart );
+                    if ( pStringEnd == nullptr )
+                    {
+                        m_pCurrent = m_pEnd;
+                        return SetError( "unterminated string" );
+                    }
+
+                    property.m_type = PropertyType::String;
+                    property.m_string.m_pData = pStringStart;
+                    property.m_string.m_length = pStringEnd - pStringStart;
+                    m_pCurrent = pStringEnd + 1;
+                    return true;
+                }
+
+                // Array, the type is only known once the values have been read
+                if ( c == '*' )
+                {
+                    m_pCurrent++;
+
+                    bool isFloatingPoint = false;
+                    double floatValue = 0;
+                    int64_t arrayLength = 0;
+                    if ( !ReadNumber( isFloatingPoint, floatValue, arrayLength ) || isFloatingPoint || arrayLength < 0 )
+                    {
+                        return SetError( "invalid array length" );
+                    }
+
+                    SkipWhitespaceAndComments();
+                    if ( Peek() != '{' )
+                    {
+                        return SetError( "expected '{' after array length" );
+                    }
+
+                    m_pCurrent++;
+                    SkipWhitespaceAndComments();
+                    if ( Peek() != 'a' || m_pCurrent + 1 >= m_pEnd || m_pCurrent[1] != ':' )
+                    {
+                        return SetError( "expected 'a:' in array" );
+                    }
+
+                    m_pCurrent += 2;
+                    property.m_type = PropertyType::DoubleArray;
+                    property.m_arraySize = (size_t) arrayLength;
+                    return true;
+                }
+
+                // Number
+                if ( ( c >= '0' && c <= '9' ) || c == '-' || c == '+' || c == '.' )
+                {
+                    bool isFloatingPoint = false;
+                    if ( !ReadNumber( isFloatingPoint, property.m_float, property.m_int ) )
+                    {
+                        return false;
+                    }
+
+                    property.m_type = isFloatingPoint ? PropertyType::Double : PropertyType::Int64;
+                    return true;
+                }
+
+                // Unquoted symbol
+                if ( IsAsciiIdentifierChar( c ) )
+                {
+                    char const* pSymbolStart = m_pCurrent;
+                    while ( m_pCurrent < m_pEnd && IsAsciiIdentifierChar( *m_pCurrent ) )
+                    {
+                        m_pCurrent++;
+                    }
+
+                    size_t const symbolLength = m_pCurrent - pSymbolStart;
+                    if ( symbolLength == 1 )
+                    {
+                        property.m_type = PropertyType::Bool;
+                        property.m_int = (uint8_t) *pSymbolStart;
+                    }
+                    else
+                    {
+                        property.m_type = PropertyType::String;
+                        property.m_string.m_pData = pSymbolStart;
+                        property.m_string.m_length = symbolLength;
+                    }
+
+                    return true;
+                }
+
+                return SetError( "unexpected character in property list" );
+            }
+
+            // Reads the values of an array and its closing brace. The values are parsed as doubles, isFloatingPointArray is set if any of them is floating point.
+            bool ReadArrayValues( size_t arraySize, std::vector<double>& values, bool& isFloatingPointArray )
+            {
+                // The count comes from the file so it only sizes the allocation up to the length of the text, each value takes at least one character.
+                // Larger counts are then rejected as a length mismatch once the values have been read.
+                values.clear();
+                values.reserve( std::min( arraySize, size_t( m_pEnd - m_pCurrent ) + 1 ) );
+                isFloatingPointArray = false;
+
+                while ( true )
+                {
+                    SkipWhitespaceAndComments();
+                    if ( Peek() == '}' )
+                    {
+                        m_pCurrent++;
+                        break;
+                    }
+
+                    if ( Peek() == ',' )
+                    {
+                        m_pCurrent++;
+                        continue;
+                    }
+
+                    bool isFloatingPoint = false;
+                    double floatValue = 0;
+                    int64_t intValue = 0;
+                    if ( IsAtEnd() || !ReadNumber( isFloatingPoint, floatValue, intValue ) )
+                    {
+                        return SetError( "invalid array value" );
+                    }
+
+                    isFloatingPointArray |= isFloatingPoint;
+                    values.emplace_back( floatValue );
+                }
+
+                if ( values.size() != arraySize )
+                {
+                    return SetError( "array length mismatch" );
+                }
+
+                return true;
+            }
+
+            // Steps over the values of an array and its closing brace without parsing them, the range of the values excludes the closing brace
+            bool SkipArrayValues( char const*& pValuesStart, char const*& pValuesEnd )
+            {
+                pValuesStart = m_pCurrent;
+                while ( m_pCurrent < m_pEnd && *m_pCurrent != '}' )
+                {
+                    if ( *m_pCurrent == ';' )
+                    {
+                        SkipWhitespaceAndComments();
+                    }
+                    else
+                    {
+                        m_pCurrent++;
+                    }
+                }
+
+                if ( IsAtEnd() )
+                {
+                    return SetError( "invalid array value" );
+                }
+
+                pValuesEnd = m_pCurrent;
+                m_pCurrent++;
+                return true;
+            }
+
+        private:
+
+            bool ReadNumber( bool& isFloatingPoint, double& floatValue, int64_t& intValue )
+            {
+                char const* pNumberStart = m_pCurrent;
+                isFloatingPoint = false;
+                while ( m_pCurrent < m_pEnd && IsAsciiNumberChar( *m_pCurrent ) )
+                {
+                    isFloatingPoint |= ( *m_pCurrent == '.' || *m_pCurrent == 'e' || *m_pCurrent == 'E' );
+                    m_pCurrent++;
+                }
+
+                // Copy the token so that the conversion functions can never read past the end of the buffer
+                char buffer[64];
+                size_t const tokenLength = m_pCurrent - pNumberStart;
+                if ( tokenLength == 0 || tokenLength >= sizeof( buffer ) )
+                {
+                    return SetError( "invalid number" );
+                }
+
+                memcpy( buffer, pNumberStart, tokenLength );
+                buffer[tokenLength] = 0;
+
+                char* pParseEnd = nullptr;
+                if ( isFloatingPoint )
+                {
+                    floatValue = strtod( buffer, &pParseEnd );
+                    intValue = (int64_t) floatValue;
+                }
+                else
+                {
+                    intValue = strtoll( buffer, &pParseEnd, 10 );
+                    floatValue = double( intValue );
+                }
+
+                if ( pParseEnd != buffer + tokenLength )
+                {
+                    return SetError( "invalid number" );
+                }
+
+                return true;
+            }
+
+        private:
+
+            char const*             m_pStart = nullptr;
+            char const*             m_pCurrent = nullptr;
+            char const*             m_pEnd = nullptr;
+            std::string&            m_errorMessage;
+        };
+
+        // Ascii files start with a "; FBX 7.4.0 project file" comment, files that lost it still have to start with the header node
+        inline bool HasAsciiHeader( char const* pData, size_t dataSize )
+        {
+            static char const headerCommentStart[] = "; FBX ";
+            static char const headerCommentEnd[] = " project file";
+            size_t const commentStartLength = sizeof( headerCommentStart ) - 1;
+            size_t const commentEndLength = sizeof( headerCommentEnd ) - 1;
+
+            char const* const pEnd = pData + dataSize;
+            char const* pCurrent = pData;
+            while ( pCurrent < pEnd && ( *pCurrent == ' ' || *pCurrent == '\t' || *pCurrent == '\r' || *pCurrent == '\n' ) )
+            {
+                pCurrent++;
+            }
+
+            if ( size_t( pEnd - pCurrent ) >= commentStartLength && memcmp( pCurrent, headerCommentStart, commentStartLength ) == 0 )
+            {
+                char const* const pVersion = pCurrent + commentStartLength;
+                char const* pVersionEnd = pVersion;
+                while ( pVersionEnd < pEnd && ( ( *pVersionEnd >= '0' && *pVersionEnd <= '9' ) || *pVersionEnd == '.' ) )
+                {
+                    pVersionEnd++;
+                }
+
+                if ( pVersionEnd > pVersion && size_t( pEnd - pVersionEnd ) >= commentEndLength && memcmp( pVersionEnd, headerCommentEnd, commentEndLength ) == 0 )
+                {
+                    return true;
+                }
+            }
+
+            std::string errorMessage;
+            AsciiLexer lexer( pData, pCurrent, pEnd, errorMessage );
+            lexer.SkipWhitespaceAndComments();
+
+            TextView name;
+            bool hasValues = false;
+            return lexer.ReadNodeName( name, hasValues ) && name == "FBXHeaderExtension";
+        }
+    }
+}
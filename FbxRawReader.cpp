@@ -0,0 +1,1009 @@
+#include "FbxRawReader.h"
+#include "FbxRawLexer.h"
+#include "Compression.h"
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+//-------------------------------------------------------------------------
+
+namespace FbxRaw
+{
+    // Smaller ascii files aren't worth splitting, the chunks are sized so each thread gets a few of them to balance out uneven chunks
+    static size_t const g_minParallelAsciiSize = 4 * 1024 * 1024;
+    static size_t const g_minAsciiChunkSize = 512 * 1024;
+    static size_t const g_numAsciiChunksPerThread = 4;
+
+    // Binary records smaller than the task size are decoded in batches, larger ones are split into their children
+    static size_t const g_minParallelBinarySize = 4 * 1024 * 1024;
+    static uint64_t const g_minBinaryTaskSize = 256 * 1024;
+    static uint64_t const g_numBinaryTasksPerThread = 8;
+
+    //-------------------------------------------------------------------------
+
+    namespace
+    {
+        // Runs the tasks on the specified number of threads (including the calling thread), stops handing out tasks as soon as one fails
+        static bool RunTasks( size_t numTasks, int numThreads, std::function<bool( size_t )> const& task )
+        {
+            std::atomic<size_t> nextTaskIdx( 0 );
+            std::atomic<bool> hasFailed( false );
+
+            auto RunWorker = [&] ()
+            {
+                size_t taskIdx = 0;
+                while ( !hasFailed && ( taskIdx = nextTaskIdx++ ) < numTasks )
+                {
+                    if ( !task( taskIdx ) )
+                    {
+                        hasFailed = true;
+                    }
+                }
+            };
+
+            std::vector<std::thread> threads;
+            size_t const numWorkers = std::min( (size_t) std::max( numThreads, 1 ), numTasks );
+            for ( size_t i = 1; i < numWorkers; i++ )
+            {
+                threads.emplace_back( RunWorker );
+            }
+
+            RunWorker();
+
+            for ( auto& thread : threads )
+            {
+                thread.join();
+            }
+
+            return !hasFailed;
+        }
+
+        // Each worker pushes the tasks it spawns onto its own queue and pops them newest first, idle workers steal the oldest tasks from the other
+        // queues. Tasks that split a large subtree therefore get their pieces picked up by whichever workers are free.
+        class WorkStealingPool
+        {
+            struct WorkerQueue
+            {
+                std::mutex                                      m_mutex;
+                std::deque<std::function<bool( int )>>          m_tasks;
+            };
+
+        public:
+
+            WorkStealingPool( int numWorkers )
+                : m_queues( std::max( numWorkers, 1 ) )
+            {}
+
+            inline int GetNumWorkers() const { return (int) m_queues.size(); }
+
+            // Tasks receive the index of the worker running them, so they can push follow up tasks onto that worker's queue
+            void Push( int workerIdx, std::function<bool( int )>&& task )
+            {
+                m_numPendingTasks++;
+                std::lock_guard<std::mutex> lock( m_queues[workerIdx].m_mutex );
+                m_queues[workerIdx].m_tasks.emplace_back( std::move( task ) );
+            }
+
+            // Runs until all the tasks, including the ones pushed by other tasks, are complete. Returns false if any task failed.
+            bool Run()
+            {
+                std::vector<std::thread> threads;
+                for ( int i = 1; i < GetNumWorkers(); i++ )
+                {
+                    threads.emplace_back( [this, i] () { RunWorker( i ); } );
+                }
+
+                RunWorker( 0 );
+
+                for ( auto& thread : threads )
+                {
+                    thread.join();
+                }
+
+                return !m_hasFailed;
+            }
+
+        private:
+
+            bool PopTask( int workerIdx, std::function<bool( int )>& task )
+            {
+                auto& queue = m_queues[workerIdx];
+                std::lock_guard<std::mutex> lock( queue.m_mutex );
+                if ( queue.m_tasks.empty() )
+                {
+                    return false;
+                }
+
+                task = std::move( queue.m_tasks.back() );
+                queue.m_tasks.pop_back();
+                return true;
+            }
+
+            bool StealTask( int workerIdx, std::function<bool( int )>& task )
+            {
+                for ( int i = 1; i < GetNumWorkers(); i++ )
+                {
+                    auto& queue = m_queues[( workerIdx + i ) % GetNumWorkers()];
+                    std::lock_guard<std::mutex> lock( queue.m_mutex );
+                    if ( !queue.m_tasks.empty() )
+                    {
+                        task = std::move( queue.m_tasks.front() );
+                        queue.m_tasks.pop_front();
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            // A running task pushes its follow up tasks before it completes, so the pending count only reaches zero once everything is done
+            void RunWorker( int workerIdx )
+            {
+                std::function<bool( int )> task;
+                while ( m_numPendingTasks > 0 )
+                {
+                    if ( PopTask( workerIdx, task ) || StealTask( workerIdx, task ) )
+                    {
+                        if ( !m_hasFailed && !task( workerIdx ) )
+                        {
+                            m_hasFailed = true;
+                        }
+
+                        task = nullptr;
+                        m_numPendingTasks--;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+
+        private:
+
+            std::vector<WorkerQueue>                            m_queues;
+            std::atomic<int64_t>                                m_numPendingTasks = { 0 };
+            std::atomic<bool>                                   m_hasFailed = { false };
+        };
+
+        //-------------------------------------------------------------------------
+
+        struct RecordRange
+        {
+            uint64_t                m_offset = 0;
+            uint64_t                m_endOffset = 0;
+        };
+
+        // Builds the document nodes out of the records and properties read by the lexer
+        class BinaryParser
+        {
+        public:
+
+            BinaryParser( char const* pData, size_t dataSize, uint32_t version, std::string& errorMessage )
+                : m_lexer( pData, dataSize, version, errorMessage )
+            {}
+
+            // Reads the node record at the offset, returns false on error. Null records (the end of a child list) set isNullRecord.
+            bool ReadNode( uint64_t& offset, uint64_t parentEndOffset, Node& node, bool& isNullRecord )
+            {
+                uint64_t childrenOffset = 0;
+                uint64_t endOffset = 0;
+                if ( !ReadNodeHeader( offset, parentEndOffset, node, childrenOffset, endOffset, isNullRecord ) )
+                {
+                    return false;
+                }
+
+                if ( isNullRecord )
+                {
+                    offset = endOffset;
+                    return true;
+                }
+
+                //-------------------------------------------------------------------------
+
+                uint64_t cursor = childrenOffset;
+                while ( cursor < endOffset )
+                {
+                    node.m_children.emplace_back();
+
+                    bool isChildNullRecord = false;
+                    if ( !ReadNode( cursor, endOffset, node.m_children.back(), isChildNullRecord ) )
+                    {
+                        return false;
+                    }
+
+                    if ( isChildNullRecord )
+                    {
+                        node.m_children.pop_back();
+                        break;
+                    }
+                }
+
+                offset = endOffset;
+                return true;
+            }
+
+            // Reads the name and properties of the node record at the offset, the children (if any) start at the returned children offset
+            bool ReadNodeHeader( uint64_t offset, uint64_t parentEndOffset, Node& node, uint64_t& childrenOffset, uint64_t& endOffset, bool& isNullRecord )
+            {
+                Lexer::RecordHeader header;
+                if ( !m_lexer.ReadRecordHeader( offset, parentEndOffset, header ) )
+                {
+                    return false;
+                }
+
+                isNullRecord = header.m_isNull;
+                endOffset = header.m_endOffset;
+                childrenOffset = header.m_propertiesEndOffset;
+                if ( isNullRecord )
+                {
+                    return true;
+                }
+
+                node.m_name = header.m_name.ToString();
+
+                //-------------------------------------------------------------------------
+
+                // The property count isn't trusted for the allocation, each property takes at least two bytes
+                uint64_t cursor = header.m_propertiesOffset;
+                node.m_properties.reserve( (size_t) std::min( header.m_numProperties, ( header.m_propertiesEndOffset - header.m_propertiesOffset ) / 2 ) );
+                for ( uint64_t i = 0; i < header.m_numProperties; i++ )
+                {
+                    PropertyView propertyView;
+                    Lexer::EncodedArray encodedArray;
+                    if ( !m_lexer.ReadProperty( cursor, header.m_propertiesEndOffset, propertyView, encodedArray ) )
+                    {
+                        return false;
+                    }
+
+                    node.m_properties.emplace_back();
+                    if ( !CopyProperty( propertyView, encodedArray, node.m_properties.back() ) )
+                    {
+                        return false;
+                    }
+                }
+
+                return m_lexer.EndProperties( header.m_offset, header.m_propertiesEndOffset, cursor );
+            }
+
+            // Finds the child records in the range without decoding them, using the end offsets stored in the record headers
+            bool FindRecords( uint64_t startOffset, uint64_t endOffset, std::vector<RecordRange>& records )
+            {
+                uint64_t cursor = startOffset;
+                while ( cursor < endOffset )
+                {
+                    Lexer::RecordHeader header;
+                    if ( !m_lexer.ReadRecordHeader( cursor, endOffset, header ) )
+                    {
+                        return false;
+                    }
+
+                    if ( header.m_isNull )
+                    {
+                        break;
+                    }
+
+                    records.push_back( { cursor, header.m_endOffset } );
+                    cursor = header.m_endOffset;
+                }
+
+                return true;
+            }
+
+        private:
+
+            bool CopyProperty( PropertyView const& propertyView, Lexer::EncodedArray const& encodedArray, Property& property )
+            {
+                property.m_type = propertyView.m_type;
+                property.m_int = propertyView.m_int;
+                property.m_float = propertyView.m_float;
+
+                if ( propertyView.IsString() )
+                {
+                    property.m_string = ( propertyView.m_type == PropertyType::String ) ? Lexer::ConvertBinaryObjectName( propertyView.m_string ) : propertyView.m_string.ToString();
+                    return true;
+                }
+
+                if ( !propertyView.IsArray() )
+                {
+                    return true;
+                }
+
+                //-------------------------------------------------------------------------
+
+                ArrayView array;
+                if ( !m_lexer.DecodeArray( propertyView, encodedArray, m_decodeBuffer, array ) )
+                {
+                    return false;
+                }
+
+                switch ( array.m_type )
+                {
+                    case PropertyType::BoolArray: CopyArrayValues<uint8_t>( array, property.m_intArray ); break;
+                    case PropertyType::Int32Array: CopyArrayValues<int32_t>( array, property.m_intArray ); break;
+                    case PropertyType::Int64Array: CopyArrayValues<int64_t>( array, property.m_intArray ); break;
+                    case PropertyType::FloatArray: CopyArrayValues<float>( array, property.m_floatArray ); break;
+                    default: CopyArrayValues<double>( array, property.m_floatArray ); break;
+                }
+
+                return true;
+            }
+
+            template<typename T, typename V>
+            static void CopyArrayValues( ArrayView const& array, std::vector<V>& values )
+            {
+                values.resize( array.m_size );
+                for ( size_t i = 0; i < array.m_size; i++ )
+                {
+                    values[i] = (V) Lexer::ReadValue<T>( array.m_pData + i * sizeof( T ) );
+                }
+            }
+
+        private:
+
+            Lexer::BinaryLexer      m_lexer;
+            std::vector<char>       m_decodeBuffer;
+        };
+
+        //-------------------------------------------------------------------------
+
+        // Decodes the records of a binary file on a work stealing pool. Large records are split up using the end offsets in the record headers: the
+        // properties are decoded straight away and the children become new tasks, so big subtrees like "Objects" are spread across all the workers.
+        // Each node is preallocated and decoded in place, so the document order is preserved without having to merge anything.
+        class ParallelBinaryDecoder
+        {
+        public:
+
+            ParallelBinaryDecoder( char const* pData, size_t dataSize, uint32_t version, int numThreads )
+                : m_pool( numThreads )
+                , m_targetTaskSize( std::max( g_minBinaryTaskSize, uint64_t( dataSize ) / ( uint64_t( m_pool.GetNumWorkers() ) * g_numBinaryTasksPerThread ) ) )
+                , m_errorMessages( m_pool.GetNumWorkers() )
+            {
+                for ( int i = 0; i < m_pool.GetNumWorkers(); i++ )
+                {
+                    m_parsers.emplace_back( new BinaryParser( pData, dataSize, version, m_errorMessages[i] ) );
+                }
+            }
+
+            // The errors aren't reported, the caller falls back to a sequential parse to get the correct error
+            bool DecodeRecords( uint64_t startOffset, uint64_t endOffset, std::vector<Node>& nodes )
+            {
+                std::vector<RecordRange> records;
+                if ( !m_parsers[0]->FindRecords( startOffset, endOffset, records ) )
+                {
+                    return false;
+                }
+
+                nodes.resize( records.size() );
+                ScheduleRecords( 0, records, nodes.data() );
+                return m_pool.Run();
+            }
+
+        private:
+
+            // Large records get their own task, runs of small records are batched into tasks of roughly the target size
+            void ScheduleRecords( int workerIdx, std::vector<RecordRange> const& records, Node* pNodes )
+            {
+                size_t batchStartIdx = 0;
+                uint64_t batchSize = 0;
+                for ( size_t i = 0; i < records.size(); i++ )
+                {
+                    uint64_t const recordSize = records[i].m_endOffset - records[i].m_offset;
+                    if ( recordSize >= m_targetTaskSize )
+                    {
+                        ScheduleBatch( workerIdx, records, batchStartIdx, i, pNodes );
+
+                        RecordRange const record = records[i];
+                        Node* pNode = pNodes + i;
+                        m_pool.Push( workerIdx, [this, record, pNode] ( int taskWorkerIdx ) { return DecodeLargeRecord( taskWorkerIdx, record, *pNode ); } );
+
+                        batchStartIdx = i + 1;
+                        batchSize = 0;
+                        continue;
+                    }
+
+                    batchSize += recordSize;
+                    if ( batchSize >= m_targetTaskSize )
+                    {
+                        ScheduleBatch( workerIdx, records, batchStartIdx, i + 1, pNodes );
+                        batchStartIdx = i + 1;
+                        batchSize = 0;
+                    }
+                }
+
+                ScheduleBatch( workerIdx, records, batchStartIdx, records.size(), pNodes );
+            }
+
+            void ScheduleBatch( int workerIdx, std::vector<RecordRange> const& records, size_t startIdx, size_t endIdx, Node* pNodes )
+            {
+                if ( startIdx == endIdx )
+                {
+                    return;
+                }
+
+                std::vector<RecordRange> batch( records.begin() + startIdx, records.begin() + endIdx );
+                Node* pBatchNodes = pNodes + startIdx;
+                m_pool.Push( workerIdx, [this, batch, pBatchNodes] ( int taskWorkerIdx )
+                {
+                    for ( size_t i = 0; i < batch.size(); i++ )
+                    {
+                        uint64_t offset = batch[i].m_offset;
+                        bool isNullRecord = false;
+                        if ( !m_parsers[taskWorkerIdx]->ReadNode( offset, batch[i].m_endOffset, pBatchNodes[i], isNullRecord ) || isNullRecord )
+                        {
+                            return false;
+                        }
+                    }
+
+                    return true;
+                } );
+            }
+
+            bool DecodeLargeRecord( int workerIdx, RecordRange const& record, Node& node )
+            {
+                uint64_t childrenOffset = 0;
+                uint64_t endOffset = 0;
+                bool isNullRecord = false;
+                BinaryParser& parser = *m_parsers[workerIdx];
+                if ( !parser.ReadNodeHeader( record.m_offset, record.m_endOffset, node, childrenOffset, endOffset, isNullRecord ) || isNullRecord )
+                {
+                    return false;
+                }
+
+                std::vector<RecordRange> childRecords;
+                if ( !parser.FindRecords( childrenOffset, endOffset, childRecords ) )
+                {
+                    return false;
+                }
+
+                node.m_children.resize( childRecords.size() );
+                ScheduleRecords( workerIdx, childRecords, node.m_children.data() );
+                return true;
+            }
+
+        private:
+
+            WorkStealingPool                                    m_pool;
+            uint64_t const                                      m_targetTaskSize = 0;
+            std::vector<std::string>                            m_errorMessages;
+            std::vector<std::unique_ptr<BinaryParser>>          m_parsers;
+        };
+
+        //-------------------------------------------------------------------------
+
+        // Builds the document nodes out of the values read by the lexer
+        class AsciiParser
+        {
+        public:
+
+            AsciiParser( char const* pData, size_t dataSize, std::string& errorMessage )
+                : m_lexer( pData, pData, pData + dataSize, errorMessage )
+            {}
+
+            // Parses a range of the file, the file start is only needed for the line numbers in the error messages
+            AsciiParser( char const* pFileStart, char const* pRangeStart, char const* pRangeEnd, std::string& errorMessage )
+                : m_lexer( pFileStart, pRangeStart, pRangeEnd, errorMessage )
+            {}
+
+            inline char const* GetCurrent() const { return m_lexer.GetCurrent(); }
+
+            bool ReadNodes( std::vector<Node>& nodes )
+            {
+                while ( true )
+                {
+                    m_lexer.SkipWhitespaceAndComments();
+                    if ( m_lexer.IsAtEnd() )
+                    {
+                        return true;
+                    }
+
+                    nodes.emplace_back();
+                    if ( !ReadNode( nodes.back() ) )
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            // Reads exactly the specified number of nodes, the range can't contain anything else
+            bool ReadNodes( Node* pNodes, size_t numNodes )
+            {
+                for ( size_t i = 0; i < numNodes; i++ )
+                {
+                    m_lexer.SkipWhitespaceAndComments();
+                    if ( m_lexer.IsAtEnd() )
+                    {
+                        return m_lexer.SetError( "unexpected end of chunk" );
+                    }
+
+                    if ( !ReadNode( pNodes[i] ) )
+                    {
+                        return false;
+                    }
+                }
+
+                m_lexer.SkipWhitespaceAndComments();
+                if ( !m_lexer.IsAtEnd() )
+                {
+                    return m_lexer.SetError( "unexpected data at end of chunk" );
+                }
+
+                return true;
+            }
+
+            // Reads the name and properties of a node, and the opening brace of its child list if it has one
+            bool ReadNodeHeader( Node& node, bool& hasChildren )
+            {
+                TextView name;
+                bool hasValues = false;
+                if ( !m_lexer.ReadNodeName( name, hasValues ) )
+                {
+                    return false;
+                }
+
+                node.m_name = name.ToString();
+
+                while ( hasValues )
+                {
+                    // Empty values (i.e. "Content: ,") are skipped
+                    if ( m_lexer.Peek() != ',' )
+                    {
+                        node.m_properties.emplace_back();
+                        if ( !ReadProperty( node.m_properties.back() ) )
+                        {
+                            return false;
+                        }
+                    }
+
+                    hasValues = m_lexer.SkipValueSeparator();
+                }
+
+                hasChildren = m_lexer.ReadChildListStart();
+                return true;
+            }
+
+        private:
+
+            bool ReadNode( Node& node )
+            {
+                bool hasChildren = false;
+                if ( !ReadNodeHeader( node, hasChildren ) )
+                {
+                    return false;
+                }
+
+                while ( hasChildren )
+                {
+                    bool isListEnd = false;
+                    if ( !m_lexer.NextChild( isListEnd ) )
+                    {
+                        return false;
+                    }
+
+                    if ( isListEnd )
+                    {
+                        break;
+                    }
+
+                    node.m_children.emplace_back();
+                    if ( !ReadNode( node.m_children.back() ) )
+                    {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            bool ReadProperty( Property& property )
+            {
+                PropertyView propertyView;
+                if ( !m_lexer.ReadProperty( propertyView ) )
+                {
+                    return false;
+                }
+
+                property.m_type = propertyView.m_type;
+                property.m_int = propertyView.m_int;
+                property.m_float = propertyView.m_float;
+
+                if ( propertyView.IsString() )
+                {
+                    property.m_string = propertyView.m_string.ToString();
+                    return true;
+                }
+
+                if ( !propertyView.IsArray() )
+                {
+                    return true;
+                }
+
+                //-------------------------------------------------------------------------
+
+                bool isFloatingPointArray = false;
+                if ( !m_lexer.ReadArrayValues( propertyView.m_arraySize, property.m_floatArray, isFloatingPointArray ) )
+                {
+                    return false;
+                }
+
+                // Integer arrays are parsed as doubles which is lossless for all the values we'll see in practice
+                if ( isFloatingPointArray )
+                {
+                    property.m_type = PropertyType::DoubleArray;
+                }
+                else
+                {
+                    property.m_type = PropertyType::Int64Array;
+                    property.m_intArray.resize( property.m_floatArray.size() );
+                    for ( size_t i = 0; i < property.m_floatArray.size(); i++ )
+                    {
+                        property.m_intArray[i] = (int64_t) property.m_floatArray[i];
+                    }
+
+                    property.m_floatArray.clear();
+                    property.m_floatArray.shrink_to_fit();
+                }
+
+                return true;
+            }
+
+        private:
+
+            Lexer::AsciiLexer       m_lexer;
+        };
+
+        //-------------------------------------------------------------------------
+
+        // The layout of a top level ascii node, as found by the brace depth scan
+        struct AsciiNodeLayout
+        {
+            char const*                 m_pStart = nullptr;
+            char const*                 m_pChildListEnd = nullptr;      // The closing brace of the child list
+            std::vector<char const*>    m_childStarts;
+        };
+
+        // A range of the file containing a known number of consecutive sibling nodes
+        struct AsciiChunk
+        {
+            char const*                 m_pStart = nullptr;
+            char const*                 m_pEnd = nullptr;
+            Node*                       m_pNodes = nullptr;
+            size_t                      m_numNodes = 0;
+        };
+
+        // Nodes always start on a new line with "Name:", so we can find the top level nodes and their direct children by tracking the brace depth at
+        // the start of each line. Strings and comments are skipped since they can contain braces. This doesn't validate anything, the parser does that.
+        static void ScanAsciiNodeLayout( char const* pData, size_t dataSize, std::vector<AsciiNodeLayout>& outNodes )
+        {
+            char const* pCurrent = pData;
+            char const* const pEnd = pData + dataSize;
+            int depth = 0;
+            bool isLineStart = true;
+
+            while ( pCurrent < pEnd )
+            {
+                if ( isLineStart )
+                {
+                    isLineStart = false;
+                    while ( pCurrent < pEnd && ( *pCurrent == ' ' || *pCurrent == '\t' || *pCurrent == '\r' ) )
+                    {
+                        pCurrent++;
+                    }
+
+                    if ( depth <= 1 && pCurrent < pEnd && Lexer::IsAsciiIdentifierChar( *pCurrent ) )
+                    {
+                        char const* pNameEnd = pCurrent;
+                        while ( pNameEnd < pEnd && Lexer::IsAsciiIdentifierChar( *pNameEnd ) )
+                        {
+                            pNameEnd++;
+                        }
+
+                        if ( pNameEnd < pEnd && *pNameEnd == ':' )
+                        {
+                            if ( depth == 0 )
+                            {
+                                outNodes.emplace_back();
+                                outNodes.back().m_pStart = pCurrent;
+                            }
+                            else if ( !outNodes.empty() )
+                            {
+                                outNodes.back().m_childStarts.emplace_back( pCurrent );
+                            }
+                        }
+
+                        pCurrent = pNameEnd;
+                        continue;
+                    }
+                }
+
+                //-------------------------------------------------------------------------
+
+                char const c = *pCurrent;
+                if ( c == '\n' )
+                {
+                    isLineStart = true;
+                    pCurrent++;
+                }
+                else if ( c == '"' )
+                {
+                    char const* pStringEnd = (char const*) memchr( pCurrent + 1, '"', pEnd - pCurrent - 1 );
+                    pCurrent = ( pStringEnd != nullptr ) ? pStringEnd + 1 : pEnd;
+                }
+                else if ( c == ';' )
+                {
+                    char const* pLineEnd = (char const*) memchr( pCurrent, '\n', pEnd - pCurrent );
+                    pCurrent = ( pLineEnd != nullptr ) ? pLineEnd : pEnd;
+                }
+                else if ( c == '{' )
+                {
+                    depth++;
+                    pCurrent++;
+                }
+                else if ( c == '}' )
+                {
+                    depth--;
+                    if ( depth == 0 && !outNodes.empty() )
+                    {
+                        outNodes.back().m_pChildListEnd = pCurrent;
+                    }
+
+                    pCurrent++;
+                }
+                else
+                {
+                    pCurrent++;
+                }
+            }
+        }
+
+        // Groups consecutive sibling nodes into chunks of roughly the target size, the first chunk starts at the range start
+        static void AddAsciiChunks( char const* pRangeStart, char const* pRangeEnd, char const* const* pNodeStarts, size_t numNodes, Node* pNodes, size_t targetChunkSize, std::vector<AsciiChunk>& chunks )
+        {
+            if ( numNodes == 0 )
+            {
+                chunks.push_back( { pRangeStart, pRangeEnd, nullptr, 0 } );
+                return;
+            }
+
+            size_t firstNodeIdx = 0;
+            char const* pChunkStart = pRangeStart;
+            for ( size_t i = 0; i < numNodes; i++ )
+            {
+                char const* pNodeEnd = ( i + 1 < numNodes ) ? pNodeStarts[i + 1] : pRangeEnd;
+                if ( (size_t) ( pNodeEnd - pChunkStart ) >= targetChunkSize || i + 1 == numNodes )
+                {
+                    chunks.push_back( { pChunkStart, pNodeEnd, pNodes + firstNodeIdx, i + 1 - firstNodeIdx } );
+                    firstNodeIdx = i + 1;
+                    pChunkStart = pNodeEnd;
+                }
+            }
+        }
+
+        // Splits the file into chunks at the top level nodes and at the children of the large top level nodes (i.e. Objects), and parses the chunks in parallel.
+        // The nodes are preallocated from the scan so each chunk parses straight into its place in the document. This fails if the scan doesn't match
+        // what the parser finds, the caller then falls back to a sequential parse to get the correct error.
+        static bool ParseAsciiChunks( char const* pData, size_t dataSize, int numThreads, std::vector<Node>& nodes )
+        {
+            std::vector<AsciiNodeLayout> nodeLayouts;
+            ScanAsciiNodeLayout( pData, dataSize, nodeLayouts );
+            if ( nodeLayouts.empty() )
+            {
+                return false;
+            }
+
+            size_t const targetChunkSize = std::max( g_minAsciiChunkSize, dataSize / ( numThreads * g_numAsciiChunksPerThread ) );
+            char const* const pDataEnd = pData + dataSize;
+
+            nodes.resize( nodeLayouts.size() );
+            std::vector<char const*> nodeStarts( nodeLayouts.size() );
+            for ( size_t i = 0; i < nodeLayouts.size(); i++ )
+            {
+                nodeStarts[i] = nodeLayouts[i].m_pStart;
+            }
+
+            //-------------------------------------------------------------------------
+
+            std::vector<AsciiChunk> chunks;
+            std::string errorMessage;
+            size_t firstUnsplitNodeIdx = 0;
+            char const* pUnsplitRangeStart = pData;
+
+            for ( size_t i = 0; i < nodeLayouts.size(); i++ )
+            {
+                auto const& layout = nodeLayouts[i];
+                char const* pNodeEnd = ( i + 1 < nodeLayouts.size() ) ? nodeStarts[i + 1] : pDataEnd;
+                if ( (size_t) ( pNodeEnd - layout.m_pStart ) < targetChunkSize || layout.m_pChildListEnd == nullptr || layout.m_pChildListEnd < layout.m_pStart )
+                {
+                    continue;
+                }
+
+                // Everything between the previous split node and this one
+                AddAsciiChunks( pUnsplitRangeStart, layout.m_pStart, nodeStarts.data() + firstUnsplitNodeIdx, i - firstUnsplitNodeIdx, nodes.data() + firstUnsplitNodeIdx, targetChunkSize, chunks );
+
+                // The header is read upfront so we know where the child list starts
+                bool hasChildren = false;
+                AsciiParser parser( pData, layout.m_pStart, pNodeEnd, errorMessage );
+                if ( !parser.ReadNodeHeader( nodes[i], hasChildren ) || !hasChildren || parser.GetCurrent() > layout.m_pChildListEnd )
+                {
+                    return false;
+                }
+
+                auto firstChildIter = std::lower_bound( layout.m_childStarts.begin(), layout.m_childStarts.end(), parser.GetCurrent() );
+                auto lastChildIter = std::lower_bound( firstChildIter, layout.m_childStarts.end(), layout.m_pChildListEnd );
+                size_t const numChildren = lastChildIter - firstChildIter;
+                nodes[i].m_children.resize( numChildren );
+                AddAsciiChunks( parser.GetCurrent(), layout.m_pChildListEnd, layout.m_childStarts.data() + ( firstChildIter - layout.m_childStarts.begin() ), numChildren, nodes[i].m_children.data(), targetChunkSize, chunks );
+
+                firstUnsplitNodeIdx = i + 1;
+                pUnsplitRangeStart = layout.m_pChildListEnd + 1;
+            }
+
+            AddAsciiChunks( pUnsplitRangeStart, pDataEnd, nodeStarts.data() + firstUnsplitNodeIdx, nodeLayouts.size() - firstUnsplitNodeIdx, nodes.data() + firstUnsplitNodeIdx, targetChunkSize, chunks );
+
+            //-------------------------------------------------------------------------
+
+            return RunTasks( chunks.size(), numThreads, [&] ( size_t chunkIdx )
+            {
+                std::string chunkErrorMessage;
+                AsciiChunk const& chunk = chunks[chunkIdx];
+                AsciiParser chunkParser( pData, chunk.m_pStart, chunk.m_pEnd, chunkErrorMessage );
+                return chunkParser.ReadNodes( chunk.m_pNodes, chunk.m_numNodes );
+            } );
+        }
+    }
+
+    //-------------------------------------------------------------------------
+
+    bool HasBinaryHeader( char const* pData, size_t dataSize )
+    {
+        return Lexer::HasBinaryMagic( pData, dataSize );
+    }
+
+    bool HasAsciiHeader( char const* pData, size_t dataSize )
+    {
+        return Lexer::HasAsciiHeader( pData, dataSize );
+    }
+
+    bool ParseBinary( char const* pData, size_t dataSize, Document& document, std::string& errorMessage, int numThreads )
+    {
+        assert( pData != nullptr );
+
+        if ( dataSize < Lexer::g_binaryHeaderSize || !Lexer::HasBinaryMagic( pData, dataSize ) )
+        {
+            errorMessage = "invalid binary FBX header";
+            return false;
+        }
+
+        document.m_nodes.clear();
+        document.m_isBinary = true;
+        document.m_version = Lexer::ReadValue<uint32_t>( pData + 23 );
+
+        //-------------------------------------------------------------------------
+
+        if ( numThreads > 1 && dataSize >= g_minParallelBinarySize )
+        {
+            ParallelBinaryDecoder decoder( pData, dataSize, document.m_version, numThreads );
+            if ( decoder.DecodeRecords( Lexer::g_binaryHeaderSize, dataSize, document.m_nodes ) )
+            {
+                return true;
+            }
+
+            document.m_nodes.clear();
+        }
+
+        BinaryParser parser( pData, dataSize, document.m_version, errorMessage );
+        uint64_t offset = Lexer::g_binaryHeaderSize;
+        while ( offset < dataSize )
+        {
+            document.m_nodes.emplace_back();
+
+            bool isNullRecord = false;
+            if ( !parser.ReadNode( offset, dataSize, document.m_nodes.back(), isNullRecord ) )
+            {
+                return false;
+            }
+
+            // The top level node list is terminated by a null record followed by the file footer
+            if ( isNullRecord )
+            {
+                document.m_nodes.pop_back();
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    bool ParseAscii( char const* pData, size_t dataSize, Document& document, std::string& errorMessage, int numThreads )
+    {
+        assert( pData != nullptr );
+
+        document.m_nodes.clear();
+        document.m_isBinary = false;
+        document.m_version = 0;
+
+        bool parsedInChunks = false;
+        if ( numThreads > 1 && dataSize >= g_minParallelAsciiSize )
+        {
+            parsedInChunks = ParseAsciiChunks( pData, dataSize, numThreads, document.m_nodes );
+        }
+
+        if ( !parsedInChunks )
+        {
+            document.m_nodes.clear();
+            AsciiParser parser( pData, dataSize, errorMessage );
+            if ( !parser.ReadNodes( document.m_nodes ) )
+            {
+                return false;
+            }
+        }
+
+        // The version is only stored in the header extension for ascii files
+        for ( auto const& node : document.m_nodes )
+        {
+            if ( node.m_name == "FBXHeaderExtension" )
+            {
+                for ( auto const& child : node.m_children )
+                {
+                    if ( child.m_name == "FBXVersion" && !child.m_properties.empty() && child.m_properties[0].IsNumber() )
+                    {
+                        document.m_version = (uint32_t) child.m_properties[0].m_int;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool ReadFile( std::string const& filePath, Document& document, std::string& errorMessage, int numThreads )
+    {
+        std::vector<char> fileData;
+
+        if ( Compression::IsCompressedFile( filePath ) )
+        {
+            if ( !Compression::DecompressFileToMemory( filePath, fileData, errorMessage ) )
+            {
+                return false;
+            }
+        }
+        else
+        {
+            FILE* fp = nullptr;
+            int errcode = fopen_s( &fp, filePath.c_str(), "rb" );
+            if ( errcode != 0 )
+            {
+                errorMessage = "failed to open file";
+                return false;
+            }
+
+            _fseeki64( fp, 0, SEEK_END );
+            size_t const fileSize = (size_t) _ftelli64( fp );
+            _fseeki64( fp, 0, SEEK_SET );
+
+            fileData.resize( fileSize );
+            size_t const readLength = fread( fileData.data(), 1, fileSize, fp );
+            fclose( fp );
+
+            if ( readLength != fileSize )
+            {
+                errorMessage = "failed to read file";
+                return false;
+            }
+        }
+
+        //-------------------------------------------------------------------------
+
+        if ( Lexer::HasBinaryMagic( fileData.data(), fileData.size() ) )
+        {
+            return ParseBinary( fileData.data(), fileData.size(), document, errorMessage, numThreads );
+        }
+
+        return ParseAscii( fileData.data(), fileData.size(), document, errorMessage, numThreads );
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------
+// Native reader for the FBX binary and ascii formats.
+// This reads the raw node/property tree of a file without going through the SDK, it has no knowledge of what the nodes mean.
+//-------------------------------------------------------------------------
+
+namespace FbxRaw
+{
+    enum class PropertyType : uint8_t
+    {
+        Bool = 'C',
+        Int16 = 'Y',
+        Int32 = 'I',
+        Int64 = 'L',
+        Float = 'F',
+        Double = 'D',
+        String = 'S',
+        Raw = 'R',
+        BoolArray = 'b',
+        Int32Array = 'i',
+        Int64Array = 'l',
+        FloatArray = 'f',
+        DoubleArray = 'd',
+    };
+
+    // Ascii files do not store the property types, so ascii properties are stored using the widest matching type (Int64, Double, String, Int64Array, DoubleArray).
+    // Unquoted single character values (i.e. "Shading: T") are stored as a Bool containing the character code.
+    // Binary object names ("Name\x00\x01Class") are converted to the ascii form ("Class::Name").
+    struct Property
+    {
+        inline bool IsArray() const { return m_type == PropertyType::BoolArray || m_type == PropertyType::Int32Array || m_type == PropertyType::Int64Array || m_type == PropertyType::FloatArray || m_type == PropertyType::DoubleArray; }
+        inline bool IsFloatingPoint() const { return m_type == PropertyType::Float || m_type == PropertyType::Double || m_type == PropertyType::FloatArray || m_type == PropertyType::DoubleArray; }
+        inline bool IsString() const { return m_type == PropertyType::String || m_type == PropertyType::Raw; }
+        inline bool IsNumber() const { return !IsArray() && !IsString(); }
+
+        inline double GetNumber() const { return IsFloatingPoint() ? m_float : double( m_int ); }
+        inline size_t GetArraySize() const { return IsFloatingPoint() ? m_floatArray.size() : m_intArray.size(); }
+        inline double GetArrayElement( size_t i ) const { return IsFloatingPoint() ? m_floatArray[i] : double( m_intArray[i] ); }
+
+    public:
+
+        PropertyType                m_type = PropertyType::Int64;
+        int64_t                     m_int = 0;
+        double                      m_float = 0;
+        std::string                 m_string;
+        std::vector<int64_t>        m_intArray;
+        std::vector<double>         m_floatArray;
+    };
+
+    struct Node
+    {
+        std::string                 m_name;
+        std::vector<Property>       m_properties;
+        std::vector<Node>           m_children;
+    };
+
+    struct Document
+    {
+        std::vector<Node>           m_nodes;
+        uint32_t                    m_version = 0;
+        bool                        m_isBinary = false;
+    };
+
+    //-------------------------------------------------------------------------
+
+    // Large binary files are decoded on the specified number of threads, large records are split into their children using the record end offsets
+    bool ParseBinary( char const* pData, size_t dataSize, Document& document, std::string& errorMessage, int numThreads = 1 );
+    // Large ascii files are split into chunks at the top level nodes, and at the children of large nodes like "Objects", which are parsed on the specified number of threads
+    bool ParseAscii( char const* pData, size_t dataSize, Document& document, std::string& errorMessage, int numThreads = 1 );
+
+    // Checks the start of a file (i.e. its first kilobyte) for the binary magic or for the ascii header comment or header node
+    bool HasBinaryHeader( char const* pData, size_t dataSize );
+    bool HasAsciiHeader( char const* pData, size_t dataSize );
+
+    // Reads and parses the specified file, the format is detected from the file header
+    bool ReadFile( std::string const& filePath, Document& document, std::string& errorMessage, int numThreads = 1 );
+}
@@ -0,0 +1,497 @@
+#include "FbxRawStream.h"
+#include "FbxRawLexer.h"
+#include "Compression.h"
+#include <windows.h>
+#include <assert.h>
+
+//-------------------------------------------------------------------------
+
+namespace FbxRaw
+{
+    size_t ArrayView::GetElementSize() const
+    {
+        return Lexer::GetArrayElementSize( m_type );
+    }
+
+    double ArrayView::GetElement( size_t i ) const
+    {
+        assert( i < m_size );
+
+        switch ( m_type )
+        {
+            case PropertyType::BoolArray: return double( Lexer::ReadValue<uint8_t>( m_pData + i ) );
+            case PropertyType::Int32Array: return double( Lexer::ReadValue<int32_t>( m_pData + i * 4 ) );
+            case PropertyType::Int64Array: return double( Lexer::ReadValue<int64_t>( m_pData + i * 8 ) );
+            case PropertyType::FloatArray: return double( Lexer::ReadValue<float>( m_pData + i * 4 ) );
+            case PropertyType::DoubleArray: return Lexer::ReadValue<double>( m_pData + i * 8 );
+            default: return 0;
+        }
+    }
+
+    std::string PropertyView::GetString() const
+    {
+        return ( m_type == PropertyType::String ) ? Lexer::ConvertBinaryObjectName( m_string ) : m_string.ToString();
+    }
+
+    //-------------------------------------------------------------------------
+
+    StreamReader::StreamReader() = default;
+
+    StreamReader::~StreamReader()
+    {
+        Close();
+    }
+
+    bool StreamReader::Open( std::string const& filePath, std::string& errorMessage )
+    {
+        Close();
+
+        if ( Compression::IsCompressedFile( filePath ) )
+        {
+            if ( !Compression::DecompressFileToMemory( filePath, m_decompressedData, errorMessage ) )
+            {
+                return false;
+            }
+
+            return StartParsing( m_decompressedData.data(), m_decompressedData.size(), errorMessage );
+        }
+
+        //-------------------------------------------------------------------------
+
+        HANDLE const fileHandle = CreateFileA( filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+        if ( fileHandle == INVALID_HANDLE_VALUE )
+        {
+            errorMessage = "failed to open file";
+            return false;
+        }
+
+        m_fileHandle = fileHandle;
+
+        LARGE_INTEGER fileSize;
+        if ( !GetFileSizeEx( fileHandle, &fileSize ) || uint64_t( fileSize.QuadPart ) > SIZE_MAX )
+        {
+            errorMessage = "failed to read file";
+            Close();
+            return false;
+        }
+
+        // Empty files can't be mapped
+        if ( fileSize.QuadPart == 0 )
+        {
+            return StartParsing( "", 0, errorMessage );
+        }
+
+        m_mappingHandle = CreateFileMappingA( fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+        m_pMappedView = ( m_mappingHandle != nullptr ) ? MapViewOfFile( m_mappingHandle, FILE_MAP_READ, 0, 0, 0 ) : nullptr;
+        if ( m_pMappedView == nullptr )
+        {
+            errorMessage = "failed to map file";
+            Close();
+            return false;
+        }
+
+        return StartParsing( static_cast<char const*>( m_pMappedView ), (size_t) fileSize.QuadPart, errorMessage );
+    }
+
+    bool StreamReader::Open( char const* pData, size_t dataSize, std::string& errorMessage )
+    {
+        assert( pData != nullptr );
+        Close();
+        return StartParsing( pData, dataSize, errorMessage );
+    }
+
+    void StreamReader::Close()
+    {
+        if ( m_pMappedView != nullptr )
+        {
+            UnmapViewOfFile( m_pMappedView );
+            m_pMappedView = nullptr;
+        }
+
+        if ( m_mappingHandle != nullptr )
+        {
+            CloseHandle( m_mappingHandle );
+            m_mappingHandle = nullptr;
+        }
+
+        if ( m_fileHandle != nullptr )
+        {
+            CloseHandle( m_fileHandle );
+            m_fileHandle = nullptr;
+        }
+
+        std::vector<char>().swap( m_decompressedData );
+        std::vector<char>().swap( m_arrayBuffer );
+        std::vector<double>().swap( m_arrayValues );
+
+        m_pData = m_pEnd = nullptr;
+        m_isBinary = false;
+        m_version = 0;
+        m_frames.clear();
+        m_pBinaryLexer.reset();
+        m_pAsciiLexer.reset();
+        m_offset = 0;
+        m_isAtEnd = false;
+        m_errorMessage.clear();
+        m_nodeName = TextView();
+        m_property = PropertyView();
+        m_isArrayDecoded = false;
+    }
+
+    bool StreamReader::StartParsing( char const* pData, size_t dataSize, std::string& errorMessage )
+    {
+        m_pData = pData;
+        m_pEnd = pData + dataSize;
+        m_isBinary = Lexer::HasBinaryMagic( pData, dataSize );
+
+        if ( m_isBinary )
+        {
+            if ( dataSize < Lexer::g_binaryHeaderSize )
+            {
+                errorMessage = "invalid binary FBX header";
+                Close();
+                return false;
+            }
+
+            m_version = Lexer::ReadValue<uint32_t>( pData + 23 );
+            m_offset = Lexer::g_binaryHeaderSize;
+            m_pBinaryLexer.reset( new Lexer::BinaryLexer( pData, dataSize, m_version, m_errorMessage ) );
+        }
+        else
+        {
+            m_pAsciiLexer.reset( new Lexer::AsciiLexer( pData, pData, m_pEnd, m_errorMessage ) );
+        }
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+
+    StreamReader::Event StreamReader::Next()
+    {
+        if ( HasError() )
+        {
+            return Event::Error;
+        }
+
+        if ( m_isAtEnd || m_pData == nullptr )
+        {
+            return Event::EndOfFile;
+        }
+
+        return m_isBinary ? NextBinary() : NextAscii();
+    }
+
+    bool StreamReader::GetArray( ArrayView& outArray )
+    {
+        if ( HasError() || !m_property.IsArray() )
+        {
+            return false;
+        }
+
+        if ( !m_isArrayDecoded )
+        {
+            if ( !( m_isBinary ? DecodeBinaryArray( m_decodedArray ) : DecodeAsciiArray( m_decodedArray ) ) )
+            {
+                return false;
+            }
+
+            m_isArrayDecoded = true;
+        }
+
+        outArray = m_decodedArray;
+        return true;
+    }
+
+    void StreamReader::SkipNode()
+    {
+        if ( HasError() || m_frames.empty() )
+        {
+            return;
+        }
+
+        Frame& frame = m_frames.back();
+        if ( m_isBinary )
+        {
+            frame.m_numRemainingProperties = 0;
+            frame.m_isReadingProperties = false;
+            m_offset = frame.m_endOffset;
+            return;
+        }
+
+        // Ascii arrays contain braces, so the properties need to be stepped over before we can match the braces of the child list
+        while ( frame.m_isReadingProperties )
+        {
+            bool hasProperty = false;
+            if ( !ReadAsciiProperty( hasProperty ) )
+            {
+                return;
+            }
+        }
+
+        if ( frame.m_hasChildren && m_pAsciiLexer->SkipChildList() )
+        {
+            frame.m_hasChildren = false;
+        }
+    }
+
+    StreamReader::Event StreamReader::PopNode()
+    {
+        assert( !m_frames.empty() );
+
+        if ( m_isBinary )
+        {
+            m_offset = m_frames.back().m_endOffset;
+        }
+
+        m_nodeName = m_frames.back().m_name;
+        m_frames.pop_back();
+        return Event::EndNode;
+    }
+
+    //-------------------------------------------------------------------------
+    // Binary
+    //-------------------------------------------------------------------------
+
+    StreamReader::Event StreamReader::NextBinary()
+    {
+        // The top level node list is terminated by a null record followed by the file footer
+        if ( m_frames.empty() )
+        {
+            uint64_t const dataSize = uint64_t( m_pEnd - m_pData );
+            bool isNullRecord = false;
+            if ( m_offset >= dataSize || ( BeginBinaryNode( dataSize, isNullRecord ) && isNullRecord ) )
+            {
+                m_isAtEnd = !HasError();
+            }
+
+            return HasError() ? Event::Error : ( m_isAtEnd ? Event::EndOfFile : Event::BeginNode );
+        }
+
+        Frame& frame = m_frames.back();
+        if ( frame.m_numRemainingProperties > 0 )
+        {
+            frame.m_numRemainingProperties--;
+            return ReadBinaryProperty() ? Event::Property : Event::Error;
+        }
+
+        if ( frame.m_isReadingProperties )
+        {
+            frame.m_isReadingProperties = false;
+            if ( !m_pBinaryLexer->EndProperties( frame.m_recordOffset, frame.m_propertiesEndOffset, m_offset ) )
+            {
+                return Event::Error;
+            }
+        }
+
+        // A null record terminates the child list
+        if ( m_offset < frame.m_endOffset )
+        {
+            bool isNullRecord = false;
+            if ( !BeginBinaryNode( frame.m_endOffset, isNullRecord ) )
+            {
+                return Event::Error;
+            }
+
+            if ( !isNullRecord )
+            {
+                return Event::BeginNode;
+            }
+        }
+
+        return PopNode();
+    }
+
+    bool StreamReader::BeginBinaryNode( uint64_t parentEndOffset, bool& isNullRecord )
+    {
+        Lexer::RecordHeader header;
+        if ( !m_pBinaryLexer->ReadRecordHeader( m_offset, parentEndOffset, header ) )
+        {
+            return false;
+        }
+
+        isNullRecord = header.m_isNull;
+        if ( isNullRecord )
+        {
+            m_offset = header.m_endOffset;
+            return true;
+        }
+
+        Frame frame;
+        frame.m_name = header.m_name;
+        frame.m_recordOffset = header.m_offset;
+        frame.m_endOffset = header.m_endOffset;
+        frame.m_propertiesEndOffset = header.m_propertiesEndOffset;
+        frame.m_numRemainingProperties = header.m_numProperties;
+        m_frames.emplace_back( frame );
+
+        m_nodeName = frame.m_name;
+        m_offset = header.m_propertiesOffset;
+        return true;
+    }
+
+    // The array values are only located here, they are decompressed if they are asked for
+    bool StreamReader::ReadBinaryProperty()
+    {
+        m_isArrayDecoded = false;
+
+        Lexer::EncodedArray encodedArray;
+        if ( !m_pBinaryLexer->ReadProperty( m_offset, m_frames.back().m_propertiesEndOffset, m_property, encodedArray ) )
+        {
+            return false;
+        }
+
+        m_pArrayData = encodedArray.m_pData;
+        m_pArrayDataEnd = encodedArray.m_pData + encodedArray.m_encodedLength;
+        m_arrayEncoding = encodedArray.m_encoding;
+        return true;
+    }
+
+    bool StreamReader::DecodeBinaryArray( ArrayView& outArray )
+    {
+        Lexer::EncodedArray encodedArray;
+        encodedArray.m_pData = m_pArrayData;
+        encodedArray.m_encodedLength = uint32_t( m_pArrayDataEnd - m_pArrayData );
+        encodedArray.m_encoding = m_arrayEncoding;
+        return m_pBinaryLexer->DecodeArray( m_property, encodedArray, m_arrayBuffer, outArray );
+    }
+
+    //-------------------------------------------------------------------------
+    // Ascii
+    //-------------------------------------------------------------------------
+
+    StreamReader::Event StreamReader::NextAscii()
+    {
+        if ( m_frames.empty() )
+        {
+            m_pAsciiLexer->SkipWhitespaceAndComments();
+            if ( m_pAsciiLexer->IsAtEnd() )
+            {
+                m_isAtEnd = true;
+                return Event::EndOfFile;
+            }
+
+            return BeginAsciiNode() ? Event::BeginNode : Event::Error;
+        }
+
+        Frame& frame = m_frames.back();
+        if ( frame.m_isReadingProperties )
+        {
+            bool hasProperty = false;
+            if ( !ReadAsciiProperty( hasProperty ) )
+            {
+                return Event::Error;
+            }
+
+            if ( hasProperty )
+            {
+                // The version is only stored in the header extension for ascii files
+                if ( m_frames.size() == 2 && frame.m_name == "FBXVersion" && m_frames[0].m_name == "FBXHeaderExtension" && m_property.IsNumber() )
+                {
+                    m_version = (uint32_t) m_property.m_int;
+                }
+
+                return Event::Property;
+            }
+        }
+
+        if ( frame.m_hasChildren )
+        {
+            bool isListEnd = false;
+            if ( !m_pAsciiLexer->NextChild( isListEnd ) )
+            {
+                return Event::Error;
+            }
+
+            if ( !isListEnd )
+            {
+                return BeginAsciiNode() ? Event::BeginNode : Event::Error;
+            }
+        }
+
+        return PopNode();
+    }
+
+    bool StreamReader::BeginAsciiNode()
+    {
+        Frame frame;
+        if ( !m_pAsciiLexer->ReadNodeName( frame.m_name, frame.m_expectValue ) )
+        {
+            return false;
+        }
+
+        m_frames.emplace_back( frame );
+        m_nodeName = frame.m_name;
+        return true;
+    }
+
+    // Reads the next value of the current node, once the values run out this reads the opening brace of the child list if there is one
+    bool StreamReader::ReadAsciiProperty( bool& hasProperty )
+    {
+        Frame& frame = m_frames.back();
+        assert( frame.m_isReadingProperties );
+
+        hasProperty = false;
+        while ( frame.m_expectValue )
+        {
+            // Empty values (i.e. "Content: ,") are skipped
+            bool const hasValue = ( m_pAsciiLexer->Peek() != ',' );
+            if ( hasValue )
+            {
+                m_isArrayDecoded = false;
+                if ( !m_pAsciiLexer->ReadProperty( m_property ) )
+                {
+                    return false;
+                }
+
+                // The array values are only located here, they are parsed if they are asked for
+                if ( m_property.IsArray() && !m_pAsciiLexer->SkipArrayValues( m_pArrayData, m_pArrayDataEnd ) )
+                {
+                    return false;
+                }
+            }
+
+            frame.m_expectValue = m_pAsciiLexer->SkipValueSeparator();
+
+            if ( hasValue )
+            {
+                hasProperty = true;
+                return true;
+            }
+        }
+
+        //-------------------------------------------------------------------------
+
+        frame.m_isReadingProperties = false;
+        frame.m_hasChildren = m_pAsciiLexer->ReadChildListStart();
+        return true;
+    }
+
+    // The values are parsed as doubles and converted to integers if none of them are floating point, the same way the Document does it
+    bool StreamReader::DecodeAsciiArray( ArrayView& outArray )
+    {
+        // The values are lexed where they are in the file (up to and including the closing brace) so the errors report the right line
+        Lexer::AsciiLexer arrayLexer( m_pData, m_pArrayData, m_pArrayDataEnd + 1, m_errorMessage );
+
+        bool isFloatingPointArray = false;
+        if ( !arrayLexer.ReadArrayValues( m_property.m_arraySize, m_arrayValues, isFloatingPointArray ) )
+        {
+            return false;
+        }
+
+        if ( !isFloatingPointArray )
+        {
+            for ( auto& value : m_arrayValues )
+            {
+                int64_t const intValue = (int64_t) value;
+                memcpy( &value, &intValue, sizeof( int64_t ) );
+            }
+        }
+
+        m_property.m_type = isFloatingPointArray ? PropertyType::DoubleArray : PropertyType::Int64Array;
+        outArray.m_type = m_property.m_type;
+        outArray.m_size = m_arrayValues.size();
+        outArray.m_pData = (char const*) m_arrayValues.data();
+        return true;
+    }
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "FbxRawReader.h"
+#include <string.h>
+#include <memory>
+
+//-------------------------------------------------------------------------
+// Streaming (pull) reader for the FBX binary and ascii formats.
+// Rather than building a Document, the reader steps through the file and reports each node and property as an event, in file order:
+//
+//      BeginNode "Geometry", Property, Property, BeginNode "Vertices", Property, EndNode, ..., EndNode
+//
+// Nothing is copied out of the file: names, strings and arrays are views into the file data, which is memory mapped. Arrays are only
+// decompressed (binary) or parsed (ascii) when GetArray is called, and whole subtrees can be skipped without reading them, so tools
+// that only need a few fields of a file scan it at I/O speed and in constant memory.
+//-------------------------------------------------------------------------
+
+namespace FbxRaw
+{
+    namespace Lexer
+    {
+        class BinaryLexer;
+        class AsciiLexer;
+    }
+
+    //-------------------------------------------------------------------------
+
+    struct TextView
+    {
+        inline std::string ToString() const { return std::string( m_pData, m_length ); }
+        inline bool operator==( char const* pString ) const { return strlen( pString ) == m_length && memcmp( m_pData, pString, m_length ) == 0; }
+        inline bool operator!=( char const* pString ) const { return !( *this == pString ); }
+
+    public:
+
+        char const*                 m_pData = nullptr;
+        size_t                      m_length = 0;
+    };
+
+    // The elements are tightly packed little endian values that aren't necessarily aligned, so they need to be copied out (i.e. with memcpy)
+    // rather than read through a cast pointer. Ascii arrays are decoded as Int64Array or DoubleArray, like in the Document.
+    struct ArrayView
+    {
+        size_t GetElementSize() const;
+        double GetElement( size_t i ) const;
+
+    public:
+
+        PropertyType                m_type = PropertyType::DoubleArray;
+        size_t                      m_size = 0;
+        char const*                 m_pData = nullptr;
+    };
+
+    // Follows the Property conventions, except that binary object names are left in their binary form ("Name\x00\x01Class"), GetString returns
+    // the ascii form. The type of ascii arrays is only known once their values have been read, so it is DoubleArray until GetArray is called.
+    struct PropertyView
+    {
+        inline bool IsArray() const { return m_type == PropertyType::BoolArray || m_type == PropertyType::Int32Array || m_type == PropertyType::Int64Array || m_type == PropertyType::FloatArray || m_type == PropertyType::DoubleArray; }
+        inline bool IsFloatingPoint() const { return m_type == PropertyType::Float || m_type == PropertyType::Double || m_type == PropertyType::FloatArray || m_type == PropertyType::DoubleArray; }
+        inline bool IsString() const { return m_type == PropertyType::String || m_type == PropertyType::Raw; }
+        inline bool IsNumber() const { return !IsArray() && !IsString(); }
+
+        inline double GetNumber() const { return IsFloatingPoint() ? m_float : double( m_int ); }
+        std::string GetString() const;
+
+    public:
+
+        PropertyType                m_type = PropertyType::Int64;
+        int64_t                     m_int = 0;
+        double                      m_float = 0;
+        TextView                    m_string;
+        size_t                      m_arraySize = 0;
+    };
+
+    //-------------------------------------------------------------------------
+
+    class StreamReader
+    {
+    public:
+
+        enum class Event
+        {
+            BeginNode,
+            Property,
+            EndNode,
+            EndOfFile,
+            Error,
+        };
+
+    public:
+
+        StreamReader();
+        ~StreamReader();
+
+        // Memory maps the file, the format is detected from the file header. Compressed files can't be mapped and are decompressed to memory.
+        bool Open( std::string const& filePath, std::string& errorMessage );
+
+        // Reads from a buffer owned by the caller, which needs to stay alive until the reader is closed
+        bool Open( char const* pData, size_t dataSize, std::string& errorMessage );
+
+        void Close();
+
+        // Moves to the next event, the views returned by the reader are valid until the reader is closed except for the arrays (see GetArray)
+        Event Next();
+
+        inline bool IsBinary() const { return m_isBinary; }
+
+        // Ascii files only store the version in the header extension, so it is 0 until the "FBXVersion" node has been read
+        inline uint32_t GetVersion() const { return m_version; }
+
+        // The number of open nodes, i.e. 1 for the top level nodes
+        inline size_t GetDepth() const { return m_frames.size(); }
+
+        // The node that was begun or ended by the current event, or the node that owns the current property
+        inline TextView GetNodeName() const { return m_nodeName; }
+
+        // Only valid for property events
+        inline PropertyView const& GetProperty() const { return m_property; }
+
+        // Decodes the current array property, the decoded data is valid until the next event
+        bool GetArray( ArrayView& outArray );
+
+        // Skips the remaining properties and all the children of the current node, the next event is the node's EndNode.
+        // Skipped data isn't validated.
+        void SkipNode();
+
+        inline std::string const& GetErrorMessage() const { return m_errorMessage; }
+
+    private:
+
+        struct Frame
+        {
+            TextView                m_name;
+            uint64_t                m_recordOffset = 0;             // Binary only
+            uint64_t                m_endOffset = 0;                // Binary only
+            uint64_t                m_propertiesEndOffset = 0;      // Binary only
+            uint64_t                m_numRemainingProperties = 0;   // Binary only
+            bool                    m_isReadingProperties = true;
+            bool                    m_expectValue = false;          // Ascii only
+            bool                    m_hasChildren = false;          // Ascii only, known once the properties have been read
+        };
+
+        StreamReader( StreamReader const& ) = delete;
+        StreamReader& operator=( StreamReader const& ) = delete;
+
+        bool StartParsing( char const* pData, size_t dataSize, std::string& errorMessage );
+
+        // The lexers write their errors straight into the error message
+        inline bool HasError() const { return !m_errorMessage.empty(); }
+
+        Event NextBinary();
+        bool BeginBinaryNode( uint64_t parentEndOffset, bool& isNullRecord );
+        bool ReadBinaryProperty();
+        bool DecodeBinaryArray( ArrayView& outArray );
+
+        Event NextAscii();
+        bool BeginAsciiNode();
+        bool ReadAsciiProperty( bool& hasProperty );
+        bool DecodeAsciiArray( ArrayView& outArray );
+
+        Event PopNode();
+
+    private:
+
+        // File mapping
+        void*                       m_fileHandle = nullptr;         // HANDLE, null rather than INVALID_HANDLE_VALUE when not open
+        void*                       m_mappingHandle = nullptr;
+        void const*                 m_pMappedView = nullptr;
+        std::vector<char>           m_decompressedData;
+
+        char const*                 m_pData = nullptr;
+        char const*                 m_pEnd = nullptr;
+        bool                        m_isBinary = false;
+        uint32_t                    m_version = 0;
+
+        // Parsing state, the binary reader works with file offsets and the ascii reader with the position of its lexer
+        std::vector<Frame>                      m_frames;
+        std::unique_ptr<Lexer::BinaryLexer>     m_pBinaryLexer;
+        std::unique_ptr<Lexer::AsciiLexer>      m_pAsciiLexer;
+        uint64_t                                m_offset = 0;
+        bool                                    m_isAtEnd = false;
+        std::string                             m_errorMessage;
+
+        // Current event
+        TextView                    m_nodeName;
+        PropertyView                m_property;
+
+        // Current array, decoded on demand
+        char const*                 m_pArrayData = nullptr;         // Binary: the encoded data, ascii: the text of the values
+        char const*                 m_pArrayDataEnd = nullptr;
+        uint32_t                    m_arrayEncoding = 0;
+        bool                        m_isArrayDecoded = false;
+        ArrayView                   m_decodedArray;
+        std::vector<char>           m_arrayBuffer;                  // Binary only
+        std::vector<double>         m_arrayValues;                  // Ascii only
+    };
+}
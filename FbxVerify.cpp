@@ -0,0 +1,680 @@
+#include "FbxVerify.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <random>
+#include <thread>
+
+//-------------------------------------------------------------------------
+
+namespace FbxVerify
+{
+    using namespace FbxRaw;
+
+    //-------------------------------------------------------------------------
+
+    namespace
+    {
+        // A pair of matching nodes that can be hashed and compared independently of the rest of the document
+        struct CompareUnit
+        {
+            Node const*             m_pNodeA = nullptr;
+            Node const*             m_pNodeB = nullptr;
+            std::string             m_path;
+        };
+
+        struct Difference
+        {
+            std::string             m_path;
+            std::string             m_description;
+        };
+
+        //-------------------------------------------------------------------------
+        // Hashing
+        //-------------------------------------------------------------------------
+        // Units with matching hashes are identical and skip the comparison, so the hash has to be at least as strict as the comparison. Values
+        // are hashed in the form the comparison sees them (numbers and array elements as doubles) so identical data hashes the same whatever
+        // the file format, and every value is prefixed with its type and length so different property lists can't produce the same bytes.
+        // The hash is a 128 bit SipHash with a random key for each run, so collisions can neither happen by chance nor be crafted.
+
+        struct Hash128
+        {
+            inline bool operator==( Hash128 const& other ) const { return m_low == other.m_low && m_high == other.m_high; }
+
+            uint64_t                m_low = 0;
+            uint64_t                m_high = 0;
+        };
+
+        // SipHash-2-4 with a 128 bit output, fed incrementally
+        class Hasher
+        {
+        public:
+
+            Hasher( uint64_t key0, uint64_t key1 )
+                : m_v0( 0x736f6d6570736575ull ^ key0 )
+                , m_v1( 0x646f72616e646f6dull ^ key1 ^ 0xee )
+                , m_v2( 0x6c7967656e657261ull ^ key0 )
+                , m_v3( 0x7465646279746573ull ^ key1 )
+            {}
+
+            void Add( void const* pData, size_t length )
+            {
+                uint8_t const* pBytes = (uint8_t const*) pData;
+                m_length += length;
+
+                // Complete the word left over from the previous call first
+                while ( m_tailLength > 0 && m_tailLength < 8 && length > 0 )
+                {
+                    m_tail |= uint64_t( *pBytes++ ) << ( 8 * m_tailLength++ );
+                    length--;
+                }
+
+                if ( m_tailLength == 8 )
+                {
+                    Compress( m_tail );
+                    m_tail = 0;
+                    m_tailLength = 0;
+                }
+
+                for ( ; length >= 8; pBytes += 8, length -= 8 )
+                {
+                    uint64_t word;
+                    memcpy( &word, pBytes, 8 );
+                    Compress( word );
+                }
+
+                for ( ; length > 0; length-- )
+                {
+                    m_tail |= uint64_t( *pBytes++ ) << ( 8 * m_tailLength++ );
+                }
+            }
+
+            template<typename T>
+            inline void AddValue( T const& value )
+            {
+                Add( &value, sizeof( T ) );
+            }
+
+            Hash128 Finish()
+            {
+                Compress( m_tail | ( m_length << 56 ) );
+
+                Hash128 hash;
+                m_v2 ^= 0xee;
+                Round(); Round(); Round(); Round();
+                hash.m_low = m_v0 ^ m_v1 ^ m_v2 ^ m_v3;
+
+                m_v1 ^= 0xdd;
+                Round(); Round(); Round(); Round();
+                hash.m_high = m_v0 ^ m_v1 ^ m_v2 ^ m_v3;
+                return hash;
+            }
+
+        private:
+
+            static inline uint64_t Rotate( uint64_t value, int numBits )
+            {
+                return ( value << numBits ) | ( value >> ( 64 - numBits ) );
+            }
+
+            inline void Round()
+            {
+                m_v0 += m_v1; m_v1 = Rotate( m_v1, 13 ); m_v1 ^= m_v0; m_v0 = Rotate( m_v0, 32 );
+                m_v2 += m_v3; m_v3 = Rotate( m_v3, 16 ); m_v3 ^= m_v2;
+                m_v0 += m_v3; m_v3 = Rotate( m_v3, 21 ); m_v3 ^= m_v0;
+                m_v2 += m_v1; m_v1 = Rotate( m_v1, 17 ); m_v1 ^= m_v2; m_v2 = Rotate( m_v2, 32 );
+            }
+
+            inline void Compress( uint64_t word )
+            {
+                m_v3 ^= word;
+                Round(); Round();
+                m_v0 ^= word;
+            }
+
+        private:
+
+            uint64_t                m_v0;
+            uint64_t                m_v1;
+            uint64_t                m_v2;
+            uint64_t                m_v3;
+            uint64_t                m_tail = 0;
+            uint64_t                m_tailLength = 0;
+            uint64_t                m_length = 0;
+        };
+
+        static char const g_base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        // Decodes standard base64 with padding, returns false for anything else
+        static bool DecodeBase64( std::string const& text, std::string& outData )
+        {
+            if ( text.length() % 4 != 0 )
+            {
+                return false;
+            }
+
+            outData.clear();
+            outData.reserve( text.length() / 4 * 3 );
+
+            for ( size_t i = 0; i < text.length(); i += 4 )
+            {
+                uint32_t value = 0;
+                int numPadding = 0;
+                for ( size_t j = 0; j < 4; j++ )
+                {
+                    char const c = text[i + j];
+                    char const* pAlphabetChar = ( c != 0 ) ? strchr( g_base64Alphabet, c ) : nullptr;
+                    if ( c == '=' && i + 4 == text.length() && j >= 2 )
+                    {
+                        numPadding++;
+                        value <<= 6;
+                    }
+                    else if ( pAlphabetChar != nullptr && numPadding == 0 )
+                    {
+                        value = ( value << 6 ) | uint32_t( pAlphabetChar - g_base64Alphabet );
+                    }
+                    else
+                    {
+                        return false;
+                    }
+                }
+
+                outData.push_back( (char) ( value >> 16 ) );
+                if ( numPadding < 2 )
+                {
+                    outData.push_back( (char) ( ( value >> 8 ) & 0xFF ) );
+                }
+                if ( numPadding < 1 )
+                {
+                    outData.push_back( (char) ( value & 0xFF ) );
+                }
+            }
+
+            return true;
+        }
+
+        // Binary files store embedded content (i.e. "Content") as a single raw property
+        inline bool IsRawContent( Node const& node )
+        {
+            return node.m_properties.size() == 1 && node.m_properties[0].m_type == PropertyType::Raw;
+        }
+
+        inline bool AreAllStrings( Node const& node )
+        {
+            return std::all_of( node.m_properties.begin(), node.m_properties.end(), [] ( Property const& property ) { return property.m_type == PropertyType::String; } );
+        }
+
+        //-------------------------------------------------------------------------
+        // Comparison
+        //-------------------------------------------------------------------------
+
+        class Comparer
+        {
+        public:
+
+            Comparer( Settings const& settings )
+                : m_settings( settings )
+            {}
+
+            bool IsIgnored( Node const& node ) const
+            {
+                return std::find( m_settings.m_ignoredNodes.begin(), m_settings.m_ignoredNodes.end(), node.m_name ) != m_settings.m_ignoredNodes.end();
+            }
+
+            void GetComparableNodes( std::vector<Node> const& nodes, std::vector<Node const*>& outNodes ) const
+            {
+                outNodes.clear();
+                for ( auto const& node : nodes )
+                {
+                    if ( !IsIgnored( node ) )
+                    {
+                        outNodes.emplace_back( &node );
+                    }
+                }
+            }
+
+            // Nodes are identified by their name and index among their siblings with the same name, object nodes also include the object name
+            static std::string GetNodePath( std::string const& parentPath, std::vector<Node const*> const& siblings, size_t nodeIdx )
+            {
+                Node const* pNode = siblings[nodeIdx];
+
+                int sameNameIdx = 0;
+                for ( size_t i = 0; i < nodeIdx; i++ )
+                {
+                    sameNameIdx += ( siblings[i]->m_name == pNode->m_name ) ? 1 : 0;
+                }
+
+                char buffer[32];
+                snprintf( buffer, sizeof( buffer ), "[%d]", sameNameIdx );
+
+                // Objects start with their ID followed by their name, other nodes (i.e. "P") start with their name
+                std::string path = parentPath + "/" + pNode->m_name + buffer;
+                size_t const numPropertiesToCheck = std::min( pNode->m_properties.size(), (size_t) 2 );
+                for ( size_t i = 0; i < numPropertiesToCheck; i++ )
+                {
+                    Property const& property = pNode->m_properties[i];
+                    if ( property.m_type == PropertyType::String && property.m_string.length() < 128 )
+                    {
+                        path += " \"" + property.m_string + "\"";
+                        break;
+                    }
+                }
+
+                return path;
+            }
+
+            // Checks that two sibling lists have the same structure, returns the index of the first mismatching node (or the size of the shorter list if only the counts differ)
+            static bool CompareSiblingNames( std::vector<Node const*> const& nodesA, std::vector<Node const*> const& nodesB, size_t& mismatchIdx )
+            {
+                size_t const numCommonNodes = std::min( nodesA.size(), nodesB.size() );
+                for ( mismatchIdx = 0; mismatchIdx < numCommonNodes; mismatchIdx++ )
+                {
+                    if ( nodesA[mismatchIdx]->m_name != nodesB[mismatchIdx]->m_name )
+                    {
+                        return false;
+                    }
+                }
+
+                return nodesA.size() == nodesB.size();
+            }
+
+            static Difference MakeSiblingMismatch( std::string const& parentPath, std::vector<Node const*> const& nodesA, std::vector<Node const*> const& nodesB, size_t mismatchIdx )
+            {
+                Difference difference;
+                char buffer[512];
+
+                if ( mismatchIdx < nodesA.size() && mismatchIdx < nodesB.size() )
+                {
+                    difference.m_path = GetNodePath( parentPath, nodesA, mismatchIdx );
+                    snprintf( buffer, sizeof( buffer ), "node name mismatch: '%s' vs '%s'", nodesA[mismatchIdx]->m_name.c_str(), nodesB[mismatchIdx]->m_name.c_str() );
+                }
+                else
+                {
+                    difference.m_path = parentPath.empty() ? "/" : parentPath;
+                    snprintf( buffer, sizeof( buffer ), "child node count mismatch: %zu vs %zu", nodesA.size(), nodesB.size() );
+                }
+
+                difference.m_description = buffer;
+                return difference;
+            }
+
+            // Hashes everything the comparison looks at, returns false if the node holds values that never compare equal (NaNs) in which case
+            // a matching hash doesn't mean the nodes match
+            bool HashNode( Node const& node, Hasher& hasher ) const
+            {
+                bool isHashConclusive = true;
+
+                hasher.AddValue( uint64_t( node.m_name.length() ) );
+                hasher.Add( node.m_name.data(), node.m_name.length() );
+
+                // Embedded content is compared as base64 against the strings of ascii files, which are split arbitrarily. Raw content gets a
+                // tag of its own so it only ever matches raw content, against ascii files it always goes through the comparison.
+                hasher.AddValue( IsRawContent( node ) ? 'r' : 'p' );
+                hasher.AddValue( uint64_t( node.m_properties.size() ) );
+
+                for ( auto const& property : node.m_properties )
+                {
+                    if ( property.IsString() )
+                    {
+                        hasher.AddValue( 's' );
+                        hasher.AddValue( uint64_t( property.m_string.length() ) );
+                        hasher.Add( property.m_string.data(), property.m_string.length() );
+                    }
+                    else if ( property.IsNumber() )
+                    {
+                        double const value = property.GetNumber();
+                        isHashConclusive &= !isnan( value );
+                        hasher.AddValue( 'n' );
+                        hasher.AddValue( value );
+                    }
+                    else
+                    {
+                        size_t const arraySize = property.GetArraySize();
+                        hasher.AddValue( 'a' );
+                        hasher.AddValue( uint64_t( arraySize ) );
+
+                        if ( property.IsFloatingPoint() )
+                        {
+                            isHashConclusive &= std::none_of( property.m_floatArray.begin(), property.m_floatArray.end(), [] ( double value ) { return isnan( value ); } );
+                            hasher.Add( property.m_floatArray.data(), arraySize * sizeof( double ) );
+                        }
+                        else
+                        {
+                            double buffer[256];
+                            for ( size_t i = 0; i < arraySize; i += 256 )
+                            {
+                                size_t const numToHash = std::min( arraySize - i, (size_t) 256 );
+                                for ( size_t j = 0; j < numToHash; j++ )
+                                {
+                                    buffer[j] = double( property.m_intArray[i + j] );
+                                }
+
+                                hasher.Add( buffer, numToHash * sizeof( double ) );
+                            }
+                        }
+                    }
+                }
+
+                std::vector<Node const*> children;
+                GetComparableNodes( node.m_children, children );
+                hasher.AddValue( uint64_t( children.size() ) );
+
+                for ( auto pChild : children )
+                {
+                    isHashConclusive &= HashNode( *pChild, hasher );
+                }
+
+                return isHashConclusive;
+            }
+
+            bool AreNumbersEqual( double a, double b ) const
+            {
+                double const scale = std::max( 1.0, std::max( fabs( a ), fabs( b ) ) );
+                return fabs( a - b ) <= m_settings.m_tolerance * scale;
+            }
+
+            // Ascii files store the content as base64, split over several strings when it is long
+            static bool CompareRawContent( Node const& rawNode, Node const& textNode, bool isRawNodeA, std::string const& path, Difference& difference )
+            {
+                std::string text;
+                for ( auto const& property : textNode.m_properties )
+                {
+                    text += property.m_string;
+                }
+
+                std::string decodedData;
+                if ( !DecodeBase64( text, decodedData ) )
+                {
+                    difference.m_path = path;
+                    difference.m_description = isRawNodeA ? "property 0: raw data vs strings that aren't base64" : "property 0: strings that aren't base64 vs raw data";
+                    return false;
+                }
+
+                std::string const& rawData = rawNode.m_properties[0].m_string;
+                if ( decodedData != rawData )
+                {
+                    char buffer[512];
+                    size_t const sizeA = isRawNodeA ? rawData.length() : decodedData.length();
+                    size_t const sizeB = isRawNodeA ? decodedData.length() : rawData.length();
+                    snprintf( buffer, sizeof( buffer ), "property 0: raw data mismatch (%zu vs %zu bytes)", sizeA, sizeB );
+                    difference.m_path = path;
+                    difference.m_description = buffer;
+                    return false;
+                }
+
+                return true;
+            }
+
+            bool CompareProperties( Node const& nodeA, Node const& nodeB, std::string const& path, Difference& difference ) const
+            {
+                char buffer[512];
+
+                if ( IsRawContent( nodeA ) && !IsRawContent( nodeB ) && AreAllStrings( nodeB ) )
+                {
+                    return CompareRawContent( nodeA, nodeB, true, path, difference );
+                }
+
+                if ( IsRawContent( nodeB ) && !IsRawContent( nodeA ) && AreAllStrings( nodeA ) )
+                {
+                    return CompareRawContent( nodeB, nodeA, false, path, difference );
+                }
+
+                if ( nodeA.m_properties.size() != nodeB.m_properties.size() )
+                {
+                    difference.m_path = path;
+                    snprintf( buffer, sizeof( buffer ), "property count mismatch: %zu vs %zu", nodeA.m_properties.size(), nodeB.m_properties.size() );
+                    difference.m_description = buffer;
+                    return false;
+                }
+
+                for ( size_t i = 0; i < nodeA.m_properties.size(); i++ )
+                {
+                    Property const& propertyA = nodeA.m_properties[i];
+                    Property const& propertyB = nodeB.m_properties[i];
+
+                    buffer[0] = 0;
+                    if ( propertyA.IsNumber() && propertyB.IsNumber() )
+                    {
+                        if ( !AreNumbersEqual( propertyA.GetNumber(), propertyB.GetNumber() ) )
+                        {
+                            snprintf( buffer, sizeof( buffer ), "property %zu: %.17g vs %.17g", i, propertyA.GetNumber(), propertyB.GetNumber() );
+                        }
+                    }
+                    else if ( propertyA.IsString() && propertyB.IsString() )
+                    {
+                        if ( propertyA.m_string != propertyB.m_string )
+                        {
+                            snprintf( buffer, sizeof( buffer ), "property %zu: string mismatch ('%.64s' vs '%.64s')", i, propertyA.m_string.c_str(), propertyB.m_string.c_str() );
+                        }
+                    }
+                    else if ( propertyA.IsArray() && propertyB.IsArray() )
+                    {
+                        size_t const arraySize = propertyA.GetArraySize();
+                        if ( arraySize != propertyB.GetArraySize() )
+                        {
+                            snprintf( buffer, sizeof( buffer ), "property %zu: array size mismatch: %zu vs %zu", i, arraySize, propertyB.GetArraySize() );
+                        }
+                        else
+                        {
+                            for ( size_t j = 0; j < arraySize; j++ )
+                            {
+                                double const a = propertyA.GetArrayElement( j );
+                                double const b = propertyB.GetArrayElement( j );
+                                if ( !AreNumbersEqual( a, b ) )
+                                {
+                                    snprintf( buffer, sizeof( buffer ), "property %zu: array element %zu: %.17g vs %.17g", i, j, a, b );
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                    else
+                    {
+                        snprintf( buffer, sizeof( buffer ), "property %zu: type mismatch: '%c' vs '%c'", i, (char) propertyA.m_type, (char) propertyB.m_type );
+                    }
+
+                    if ( buffer[0] != 0 )
+                    {
+                        difference.m_path = path;
+                        difference.m_description = buffer;
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            bool CompareNodes( Node const& nodeA, Node const& nodeB, std::string const& path, Difference& difference ) const
+            {
+                if ( !CompareProperties( nodeA, nodeB, path, difference ) )
+                {
+                    return false;
+                }
+
+                std::vector<Node const*> childrenA, childrenB;
+                GetComparableNodes( nodeA.m_children, childrenA );
+                GetComparableNodes( nodeB.m_children, childrenB );
+
+                size_t const numCommonChildren = std::min( childrenA.size(), childrenB.size() );
+                for ( size_t i = 0; i < numCommonChildren; i++ )
+                {
+                    if ( childrenA[i]->m_name != childrenB[i]->m_name )
+                    {
+                        difference = MakeSiblingMismatch( path, childrenA, childrenB, i );
+                        return false;
+                    }
+
+                    if ( !CompareNodes( *childrenA[i], *childrenB[i], GetNodePath( path, childrenA, i ), difference ) )
+                    {
+                        return false;
+                    }
+                }
+
+                if ( childrenA.size() != childrenB.size() )
+                {
+                    difference = MakeSiblingMismatch( path, childrenA, childrenB, numCommonChildren );
+                    return false;
+                }
+
+                return true;
+            }
+
+        private:
+
+            Settings const&         m_settings;
+        };
+    }
+
+    //-------------------------------------------------------------------------
+
+    bool CompareDocuments( FbxRaw::Document const& documentA, FbxRaw::Document const& documentB, Settings const& settings, std::string& differencePath, std::string& differenceDescription )
+    {
+        Comparer const comparer( settings );
+
+        // Split the documents into independent units, the top level nodes and the individual objects.
+        // We stop at the first structural mismatch but only report it if none of the units before it differ.
+        //-------------------------------------------------------------------------
+
+        std::vector<CompareUnit> units;
+        std::vector<Node const*> nodesA, nodesB;
+        comparer.GetComparableNodes( documentA.m_nodes, nodesA );
+        comparer.GetComparableNodes( documentB.m_nodes, nodesB );
+
+        bool hasStructuralDifference = false;
+        Difference structuralDifference;
+
+        size_t mismatchIdx = 0;
+        bool const topLevelMatches = Comparer::CompareSiblingNames( nodesA, nodesB, mismatchIdx );
+        if ( !topLevelMatches )
+        {
+            hasStructuralDifference = true;
+            structuralDifference = Comparer::MakeSiblingMismatch( "", nodesA, nodesB, mismatchIdx );
+        }
+
+        // Differences inside the objects node always come before a top level mismatch, so they replace it
+        for ( size_t i = 0; i < mismatchIdx; i++ )
+        {
+            std::string const nodePath = Comparer::GetNodePath( "", nodesA, i );
+            if ( nodesA[i]->m_name != "Objects" )
+            {
+                units.push_back( { nodesA[i], nodesB[i], nodePath } );
+                continue;
+            }
+
+            if ( !comparer.CompareProperties( *nodesA[i], *nodesB[i], nodePath, structuralDifference ) )
+            {
+                hasStructuralDifference = true;
+                break;
+            }
+
+            std::vector<Node const*> objectsA, objectsB;
+            comparer.GetComparableNodes( nodesA[i]->m_children, objectsA );
+            comparer.GetComparableNodes( nodesB[i]->m_children, objectsB );
+
+            size_t objectMismatchIdx = 0;
+            bool const objectsMatch = Comparer::CompareSiblingNames( objectsA, objectsB, objectMismatchIdx );
+
+            for ( size_t j = 0; j < objectMismatchIdx; j++ )
+            {
+                units.push_back( { objectsA[j], objectsB[j], Comparer::GetNodePath( nodePath, objectsA, j ) } );
+            }
+
+            if ( !objectsMatch )
+            {
+                hasStructuralDifference = true;
+                structuralDifference = Comparer::MakeSiblingMismatch( nodePath, objectsA, objectsB, objectMismatchIdx );
+                break;
+            }
+        }
+
+        int numThreads = settings.m_numThreads;
+        if ( numThreads <= 0 )
+        {
+            numThreads = std::max( 1, (int) std::thread::hardware_concurrency() );
+        }
+
+        auto RunOnAllThreads = [numThreads] ( std::function<void()> const& function )
+        {
+            std::vector<std::thread> threads;
+            for ( int i = 1; i < numThreads; i++ )
+            {
+                threads.emplace_back( function );
+            }
+
+            function();
+
+            for ( auto& thread : threads )
+            {
+                thread.join();
+            }
+        };
+
+        // Hash all units in parallel, the units with matching hashes are identical
+        //-------------------------------------------------------------------------
+
+        std::random_device randomDevice;
+        uint64_t const hashKey0 = ( uint64_t( randomDevice() ) << 32 ) | randomDevice();
+        uint64_t const hashKey1 = ( uint64_t( randomDevice() ) << 32 ) | randomDevice();
+
+        std::vector<uint8_t> isUnitIdentical( units.size(), 0 );
+        std::atomic<size_t> nextUnitIdx( 0 );
+
+        RunOnAllThreads( [&] ()
+        {
+            size_t unitIdx;
+            while ( ( unitIdx = nextUnitIdx++ ) < units.size() )
+            {
+                Hasher hasherA( hashKey0, hashKey1 ), hasherB( hashKey0, hashKey1 );
+                bool const isConclusiveA = comparer.HashNode( *units[unitIdx].m_pNodeA, hasherA );
+                bool const isConclusiveB = comparer.HashNode( *units[unitIdx].m_pNodeB, hasherB );
+                isUnitIdentical[unitIdx] = ( isConclusiveA && isConclusiveB && hasherA.Finish() == hasherB.Finish() ) ? 1 : 0;
+            }
+        } );
+
+        // Compare the remaining units in parallel. Once a unit differs, the units after it in document order can't change the result anymore
+        // so they are skipped.
+        //-------------------------------------------------------------------------
+
+        std::vector<Difference> unitDifferences( units.size() );
+        std::atomic<size_t> firstDifferentUnitIdx( units.size() );
+        nextUnitIdx = 0;
+
+        RunOnAllThreads( [&] ()
+        {
+            size_t unitIdx;
+            while ( ( unitIdx = nextUnitIdx++ ) < units.size() )
+            {
+                if ( isUnitIdentical[unitIdx] || unitIdx > firstDifferentUnitIdx )
+                {
+                    continue;
+                }
+
+                if ( !comparer.CompareNodes( *units[unitIdx].m_pNodeA, *units[unitIdx].m_pNodeB, units[unitIdx].m_path, unitDifferences[unitIdx] ) )
+                {
+                    size_t currentIdx = firstDifferentUnitIdx;
+                    while ( unitIdx < currentIdx && !firstDifferentUnitIdx.compare_exchange_weak( currentIdx, unitIdx ) ) {}
+                }
+            }
+        } );
+
+        if ( firstDifferentUnitIdx < units.size() )
+        {
+            differencePath = unitDifferences[firstDifferentUnitIdx].m_path;
+            differenceDescription = unitDifferences[firstDifferentUnitIdx].m_description;
+            return false;
+        }
+
+        if ( hasStructuralDifference )
+        {
+            differencePath = structuralDifference.m_path;
+            differenceDescription = structuralDifference.m_description;
+            return false;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "FbxRawReader.h"
+
+//-------------------------------------------------------------------------
+// Semantic comparison of two FBX documents at the node/property level.
+// Works across formats so a binary file can be compared against its ascii conversion.
+//-------------------------------------------------------------------------
+
+namespace FbxVerify
+{
+    struct Settings
+    {
+        // Numeric values a and b are considered equal if |a - b| <= tolerance * max( 1, |a|, |b| )
+        double                      m_tolerance = 1e-6;
+
+        // Nodes with these names are skipped, by default these are the nodes that change every time a file is saved
+        std::vector<std::string>    m_ignoredNodes = { "FBXHeaderExtension", "FileId", "CreationTime", "Creator" };
+
+        // The number of threads used to hash and compare the documents, 0 uses one per core
+        int                         m_numThreads = 0;
+    };
+
+    // Returns true if the documents match, otherwise the path to and a description of the first difference is returned
+    bool CompareDocuments( FbxRaw::Document const& documentA, FbxRaw::Document const& documentB, Settings const& settings, std::string& differencePath, std::string& differenceDescription );
+}
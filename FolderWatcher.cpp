@@ -0,0 +1,141 @@
+#include "FolderWatcher.h"
+#include <assert.h>
+
+//-------------------------------------------------------------------------
+
+namespace
+{
+    // Network shares don't support buffers larger than 64KB
+    static DWORD const s_bufferSize = 64 * 1024;
+
+    static DWORD const s_notifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+}
+
+//-------------------------------------------------------------------------
+
+FolderWatcher::FolderWatcher( std::string const& directoryPath )
+    : m_directoryPath( directoryPath )
+    , m_buffer( s_bufferSize / sizeof( DWORD ) )
+{
+    assert( !m_directoryPath.empty() && m_directoryPath.back() == '\\' );
+
+    memset( &m_overlapped, 0, sizeof( m_overlapped ) );
+    m_overlapped.hEvent = CreateEventA( nullptr, TRUE, FALSE, nullptr );
+
+    m_directoryHandle = CreateFileA( m_directoryPath.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr );
+    if ( m_directoryHandle != INVALID_HANDLE_VALUE && m_overlapped.hEvent != nullptr )
+    {
+        m_isValid = IssueRead();
+    }
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    if ( m_directoryHandle != INVALID_HANDLE_VALUE )
+    {
+        // The pending request writes into our buffer, so we need to wait for the cancellation to complete
+        if ( m_isValid )
+        {
+            DWORD numBytesTransferred = 0;
+            CancelIo( m_directoryHandle );
+            GetOverlappedResult( m_directoryHandle, &m_overlapped, &numBytesTransferred, TRUE );
+        }
+
+        CloseHandle( m_directoryHandle );
+    }
+
+    if ( m_overlapped.hEvent != nullptr )
+    {
+        CloseHandle( m_overlapped.hEvent );
+    }
+}
+
+bool FolderWatcher::IssueRead()
+{
+    ResetEvent( m_overlapped.hEvent );
+    return ReadDirectoryChangesW( m_directoryHandle, m_buffer.data(), (DWORD) ( m_buffer.size() * sizeof( DWORD ) ), TRUE, s_notifyFilter, nullptr, &m_overlapped, nullptr ) != FALSE;
+}
+
+FolderWatcher::WaitResult FolderWatcher::WaitForChanges( DWORD timeoutMS, std::vector<std::string>& outChangedPaths )
+{
+    if ( !m_isValid )
+    {
+        return WaitResult::Error;
+    }
+
+    DWORD const waitResult = WaitForSingleObject( m_overlapped.hEvent, timeoutMS );
+    if ( waitResult == WAIT_TIMEOUT )
+    {
+        return WaitResult::Timeout;
+    }
+
+    if ( waitResult != WAIT_OBJECT_0 )
+    {
+        m_isValid = false;
+        return WaitResult::Error;
+    }
+
+    //-------------------------------------------------------------------------
+
+    WaitResult result = WaitResult::Changes;
+
+    DWORD numBytesTransferred = 0;
+    if ( !GetOverlappedResult( m_directoryHandle, &m_overlapped, &numBytesTransferred, FALSE ) )
+    {
+        if ( GetLastError() != ERROR_NOTIFY_ENUM_DIR )
+        {
+            m_isValid = false;
+            return WaitResult::Error;
+        }
+
+        result = WaitResult::Overflow;
+    }
+    else if ( numBytesTransferred == 0 )
+    {
+        result = WaitResult::Overflow;
+    }
+    else
+    {
+        // The buffer is reused by the next request, so we need to read the changes out before issuing it
+        char nameBuffer[MAX_PATH * 4];
+        auto pBufferStart = reinterpret_cast<BYTE const*>( m_buffer.data() );
+        DWORD entryOffset = 0;
+
+        while ( true )
+        {
+            auto pInfo = reinterpret_cast<FILE_NOTIFY_INFORMATION const*>( pBufferStart + entryOffset );
+            if ( pInfo->Action == FILE_ACTION_ADDED || pInfo->Action == FILE_ACTION_MODIFIED || pInfo->Action == FILE_ACTION_RENAMED_NEW_NAME )
+            {
+                int const nameLength = WideCharToMultiByte( CP_ACP, 0, pInfo->FileName, (int) ( pInfo->FileNameLength / sizeof( WCHAR ) ), nameBuffer, (int) sizeof( nameBuffer ), nullptr, nullptr );
+                if ( nameLength > 0 )
+                {
+                    std::string changedPath = m_directoryPath + std::string( nameBuffer, nameLength );
+
+                    // Directories are modified whenever their contents change, and those changes are already reported on their own
+                    DWORD const attributes = ( pInfo->Action == FILE_ACTION_MODIFIED ) ? GetFileAttributesA( changedPath.c_str() ) : INVALID_FILE_ATTRIBUTES;
+                    if ( attributes == INVALID_FILE_ATTRIBUTES || !( attributes & FILE_ATTRIBUTE_DIRECTORY ) )
+                    {
+                        outChangedPaths.emplace_back( std::move( changedPath ) );
+                    }
+                }
+            }
+
+            if ( pInfo->NextEntryOffset == 0 )
+            {
+                break;
+            }
+
+            entryOffset += pInfo->NextEntryOffset;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+
+    if ( !IssueRead() )
+    {
+        m_isValid = false;
+        return WaitResult::Error;
+    }
+
+    return result;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------
+// Watches a directory tree for files being created, modified or renamed into it.
+// The directory is monitored with an overlapped ReadDirectoryChangesW request that is always kept in flight, so no changes are missed
+// while the caller is busy converting. If too many changes happen at once the OS drops them and we report an overflow instead.
+//-------------------------------------------------------------------------
+
+class FolderWatcher
+{
+public:
+
+    enum class WaitResult
+    {
+        Timeout,
+        Changes,
+        Overflow,   // The changes were lost, the caller needs to rescan the directory
+        Error,
+    };
+
+public:
+
+    // The directory path needs to be a full path with a trailing slash
+    FolderWatcher( std::string const& directoryPath );
+    ~FolderWatcher();
+
+    inline bool IsValid() const { return m_isValid; }
+
+    // Waits for the next batch of changes, the changed paths are full paths and can contain duplicates and directories that were added or renamed
+    WaitResult WaitForChanges( DWORD timeoutMS, std::vector<std::string>& outChangedPaths );
+
+private:
+
+    FolderWatcher( FolderWatcher const& ) = delete;
+    FolderWatcher& operator=( FolderWatcher const& ) = delete;
+
+    bool IssueRead();
+
+private:
+
+    std::string                 m_directoryPath;
+    HANDLE                      m_directoryHandle = INVALID_HANDLE_VALUE;
+    OVERLAPPED                  m_overlapped;
+    std::vector<DWORD>          m_buffer;           // DWORD aligned as required by ReadDirectoryChangesW
+    bool                        m_isValid = false;
+};
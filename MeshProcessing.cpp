@@ -0,0 +1,746 @@
+#include "MeshProcessing.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <xmmintrin.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//-------------------------------------------------------------------------
+// Tangents are generated per polygon vertex, the same way as most engines do it at load time:
+//
+//  1. Each triangle contributes its UV aligned tangent and bitangent to its vertices. Polygons that aren't triangles are fanned, so this
+//     works on meshes that haven't been triangulated. Corners that share a control point and a UV share their tangent, which keeps it
+//     smooth across the polygons.
+//  2. Each corner's tangent is orthogonalized against the corner's normal, the handedness comes from the accumulated bitangent and the
+//     binormal is rebuilt from the normal and the tangent.
+//
+// Both steps run on four triangles/corners at a time with SSE: the data is gathered into structure of arrays batches and the results are
+// scattered back. Meshes are gathered from the SDK in batches so that large scenes never need a copy of all their geometry at once.
+//-------------------------------------------------------------------------
+
+namespace MeshProcessing
+{
+    namespace
+    {
+        static size_t const s_maxCornersPerBatch = 4 * 1024 * 1024;
+        static float const s_minLengthSq = 1e-24f;
+
+        struct MeshTask
+        {
+            FbxMesh*                    m_pMesh = nullptr;
+
+            // Inputs, gathered on the calling thread
+            std::vector<float>          m_controlPoints;            // xyz per control point
+            std::vector<int>            m_cornerControlPoints;      // Per polygon vertex
+            std::vector<int>            m_triangleCorners;          // 3 polygon vertices per triangle
+            std::vector<float>          m_cornerUVs;                // uv per polygon vertex
+            std::vector<float>          m_cornerNormals;            // xyz per polygon vertex, empty if the mesh has no normals
+
+            // Outputs, computed on the workers
+            std::vector<float>          m_generatedNormals;         // xyz per control point, only for meshes without normals
+            std::vector<float>          m_tangents;                 // xyzw per polygon vertex, w is the handedness
+            std::vector<float>          m_binormals;                // xyz per polygon vertex
+        };
+
+        //-------------------------------------------------------------------------
+        // Kernels
+        //-------------------------------------------------------------------------
+
+        struct alignas( 16 ) TriangleBatch
+        {
+            float                       m_positions[3][3][4];       // [corner][axis][triangle]
+            float                       m_uvs[3][2][4];             // [corner][axis][triangle]
+            float                       m_tangents[3][4];           // [axis][triangle]
+            float                       m_bitangents[3][4];
+            float                       m_normals[3][4];            // Area weighted
+        };
+
+        struct alignas( 16 ) CornerBatch
+        {
+            float                       m_normals[3][4];            // [axis][corner]
+            float                       m_tangents[4][4];           // In: accumulated tangent, out: unit tangent and handedness
+            float                       m_bitangents[3][4];         // In: accumulated bitangent, out: binormal
+        };
+
+        static inline __m128 Dot( __m128 const* a, __m128 const* b )
+        {
+            return _mm_add_ps( _mm_add_ps( _mm_mul_ps( a[0], b[0] ), _mm_mul_ps( a[1], b[1] ) ), _mm_mul_ps( a[2], b[2] ) );
+        }
+
+        static inline void Cross( __m128 const* a, __m128 const* b, __m128* out )
+        {
+            out[0] = _mm_sub_ps( _mm_mul_ps( a[1], b[2] ), _mm_mul_ps( a[2], b[1] ) );
+            out[1] = _mm_sub_ps( _mm_mul_ps( a[2], b[0] ), _mm_mul_ps( a[0], b[2] ) );
+            out[2] = _mm_sub_ps( _mm_mul_ps( a[0], b[1] ), _mm_mul_ps( a[1], b[0] ) );
+        }
+
+        // 1 / length, or 0 for vectors that are too short to be normalized
+        static inline __m128 InverseLength( __m128 lengthSq )
+        {
+            __m128 const isValid = _mm_cmpgt_ps( lengthSq, _mm_set1_ps( s_minLengthSq ) );
+            __m128 const inverseLength = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_sqrt_ps( _mm_max_ps( lengthSq, _mm_set1_ps( s_minLengthSq ) ) ) );
+            return _mm_and_ps( isValid, inverseLength );
+        }
+
+        // The tangents are scaled by the sign of the UV area rather than divided by it, so that triangles with tiny or degenerate UVs don't
+        // swamp their neighbors. Triangles with no UV area contribute nothing.
+        static void ComputeTriangleFrames( TriangleBatch& batch )
+        {
+            __m128 const one = _mm_set1_ps( 1.0f );
+            __m128 const zero = _mm_setzero_ps();
+
+            __m128 edge1[3], edge2[3];
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                __m128 const p0 = _mm_load_ps( batch.m_positions[0][axis] );
+                edge1[axis] = _mm_sub_ps( _mm_load_ps( batch.m_positions[1][axis] ), p0 );
+                edge2[axis] = _mm_sub_ps( _mm_load_ps( batch.m_positions[2][axis] ), p0 );
+            }
+
+            __m128 const u0 = _mm_load_ps( batch.m_uvs[0][0] );
+            __m128 const v0 = _mm_load_ps( batch.m_uvs[0][1] );
+            __m128 const du1 = _mm_sub_ps( _mm_load_ps( batch.m_uvs[1][0] ), u0 );
+            __m128 const dv1 = _mm_sub_ps( _mm_load_ps( batch.m_uvs[1][1] ), v0 );
+            __m128 const du2 = _mm_sub_ps( _mm_load_ps( batch.m_uvs[2][0] ), u0 );
+            __m128 const dv2 = _mm_sub_ps( _mm_load_ps( batch.m_uvs[2][1] ), v0 );
+
+            __m128 const uvArea = _mm_sub_ps( _mm_mul_ps( du1, dv2 ), _mm_mul_ps( du2, dv1 ) );
+            __m128 const uvSign = _mm_sub_ps( _mm_and_ps( _mm_cmpgt_ps( uvArea, zero ), one ), _mm_and_ps( _mm_cmplt_ps( uvArea, zero ), one ) );
+
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                __m128 const tangent = _mm_sub_ps( _mm_mul_ps( edge1[axis], dv2 ), _mm_mul_ps( edge2[axis], dv1 ) );
+                __m128 const bitangent = _mm_sub_ps( _mm_mul_ps( edge2[axis], du1 ), _mm_mul_ps( edge1[axis], du2 ) );
+                _mm_store_ps( batch.m_tangents[axis], _mm_mul_ps( tangent, uvSign ) );
+                _mm_store_ps( batch.m_bitangents[axis], _mm_mul_ps( bitangent, uvSign ) );
+            }
+
+            __m128 normal[3];
+            Cross( edge1, edge2, normal );
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                _mm_store_ps( batch.m_normals[axis], normal[axis] );
+            }
+        }
+
+        // Degenerate tangents (e.g. corners without any UV area) come out as zero and need to be fixed up by the caller
+        static void ComputeCornerFrames( CornerBatch& batch )
+        {
+            __m128 normal[3], tangent[3], bitangent[3];
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                normal[axis] = _mm_load_ps( batch.m_normals[axis] );
+                tangent[axis] = _mm_load_ps( batch.m_tangents[axis] );
+                bitangent[axis] = _mm_load_ps( batch.m_bitangents[axis] );
+            }
+
+            __m128 const inverseNormalLength = InverseLength( Dot( normal, normal ) );
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                normal[axis] = _mm_mul_ps( normal[axis], inverseNormalLength );
+            }
+
+            // Gram-Schmidt
+            __m128 const normalDotTangent = Dot( normal, tangent );
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                tangent[axis] = _mm_sub_ps( tangent[axis], _mm_mul_ps( normal[axis], normalDotTangent ) );
+            }
+
+            __m128 const inverseTangentLength = InverseLength( Dot( tangent, tangent ) );
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                tangent[axis] = _mm_mul_ps( tangent[axis], inverseTangentLength );
+            }
+
+            __m128 binormal[3];
+            Cross( normal, tangent, binormal );
+
+            __m128 const isMirrored = _mm_cmplt_ps( Dot( binormal, bitangent ), _mm_setzero_ps() );
+            __m128 const handedness = _mm_or_ps( _mm_and_ps( isMirrored, _mm_set1_ps( -1.0f ) ), _mm_andnot_ps( isMirrored, _mm_set1_ps( 1.0f ) ) );
+
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                _mm_store_ps( batch.m_tangents[axis], tangent[axis] );
+                _mm_store_ps( batch.m_bitangents[axis], _mm_mul_ps( binormal[axis], handedness ) );
+            }
+            _mm_store_ps( batch.m_tangents[3], handedness );
+        }
+
+        //-------------------------------------------------------------------------
+        // Computation, runs on the workers and doesn't touch the SDK
+        //-------------------------------------------------------------------------
+
+        struct TangentVertexKey
+        {
+            inline bool operator==( TangentVertexKey const& other ) const { return m_controlPointIdx == other.m_controlPointIdx && m_u == other.m_u && m_v == other.m_v; }
+
+        public:
+
+            int                         m_controlPointIdx;
+            uint32_t                    m_u;                        // Bit patterns of the UV
+            uint32_t                    m_v;
+        };
+
+        struct TangentVertexKeyHash
+        {
+            inline size_t operator()( TangentVertexKey const& key ) const
+            {
+                uint64_t const uv = ( uint64_t( key.m_u ) << 32 ) | key.m_v;
+                return std::hash<uint64_t>()( uv * 0x9E3779B97F4A7C15ull + uint32_t( key.m_controlPointIdx ) );
+            }
+        };
+
+        static void ComputeTangents( MeshTask& task )
+        {
+            size_t const numControlPoints = task.m_controlPoints.size() / 3;
+            size_t const numCorners = task.m_cornerControlPoints.size();
+            size_t const numTriangles = task.m_triangleCorners.size() / 3;
+            bool const generateNormals = task.m_cornerNormals.empty();
+
+            // Assign the corners to tangent vertices
+            //-------------------------------------------------------------------------
+
+            std::vector<int> cornerVertices( numCorners );
+            std::unordered_map<TangentVertexKey, int, TangentVertexKeyHash> vertexIndices;
+            vertexIndices.reserve( numCorners );
+
+            for ( size_t i = 0; i < numCorners; i++ )
+            {
+                TangentVertexKey key;
+                key.m_controlPointIdx = task.m_cornerControlPoints[i];
+                memcpy( &key.m_u, &task.m_cornerUVs[i * 2], sizeof( float ) );
+                memcpy( &key.m_v, &task.m_cornerUVs[i * 2 + 1], sizeof( float ) );
+                cornerVertices[i] = vertexIndices.emplace( key, (int) vertexIndices.size() ).first->second;
+            }
+
+            size_t const numVertices = vertexIndices.size();
+            vertexIndices.clear();
+
+            // Accumulate the triangle frames
+            //-------------------------------------------------------------------------
+
+            std::vector<float> vertexTangents( numVertices * 3, 0.0f );
+            std::vector<float> vertexBitangents( numVertices * 3, 0.0f );
+            std::vector<float> controlPointNormals( generateNormals ? numControlPoints * 3 : 0, 0.0f );
+
+            TriangleBatch triangleBatch;
+            for ( size_t firstTriangle = 0; firstTriangle < numTriangles; firstTriangle += 4 )
+            {
+                size_t const numBatchTriangles = std::min( numTriangles - firstTriangle, size_t( 4 ) );
+                memset( &triangleBatch, 0, sizeof( triangleBatch ) );
+
+                for ( size_t t = 0; t < numBatchTriangles; t++ )
+                {
+                    for ( int c = 0; c < 3; c++ )
+                    {
+                        int const cornerIdx = task.m_triangleCorners[( firstTriangle + t ) * 3 + c];
+                        float const* pPosition = &task.m_controlPoints[task.m_cornerControlPoints[cornerIdx] * 3];
+                        triangleBatch.m_positions[c][0][t] = pPosition[0];
+                        triangleBatch.m_positions[c][1][t] = pPosition[1];
+                        triangleBatch.m_positions[c][2][t] = pPosition[2];
+                        triangleBatch.m_uvs[c][0][t] = task.m_cornerUVs[cornerIdx * 2];
+                        triangleBatch.m_uvs[c][1][t] = task.m_cornerUVs[cornerIdx * 2 + 1];
+                    }
+                }
+
+                ComputeTriangleFrames( triangleBatch );
+
+                for ( size_t t = 0; t < numBatchTriangles; t++ )
+                {
+                    for ( int c = 0; c < 3; c++ )
+                    {
+                        int const cornerIdx = task.m_triangleCorners[( firstTriangle + t ) * 3 + c];
+                        float* pTangent = &vertexTangents[cornerVertices[cornerIdx] * 3];
+                        float* pBitangent = &vertexBitangents[cornerVertices[cornerIdx] * 3];
+                        for ( int axis = 0; axis < 3; axis++ )
+                        {
+                            pTangent[axis] += triangleBatch.m_tangents[axis][t];
+                            pBitangent[axis] += triangleBatch.m_bitangents[axis][t];
+                        }
+
+                        if ( generateNormals )
+                        {
+                            float* pNormal = &controlPointNormals[task.m_cornerControlPoints[cornerIdx] * 3];
+                            for ( int axis = 0; axis < 3; axis++ )
+                            {
+                                pNormal[axis] += triangleBatch.m_normals[axis][t];
+                            }
+                        }
+                    }
+                }
+            }
+
+            // Generated normals are smooth across each control point
+            //-------------------------------------------------------------------------
+
+            if ( generateNormals )
+            {
+                task.m_generatedNormals.resize( numControlPoints * 3 );
+                for ( size_t i = 0; i < numControlPoints; i++ )
+                {
+                    float const* pNormal = &controlPointNormals[i * 3];
+                    float const lengthSq = pNormal[0] * pNormal[0] + pNormal[1] * pNormal[1] + pNormal[2] * pNormal[2];
+                    float const inverseLength = ( lengthSq > s_minLengthSq ) ? 1.0f / sqrtf( lengthSq ) : 0.0f;
+                    for ( int axis = 0; axis < 3; axis++ )
+                    {
+                        task.m_generatedNormals[i * 3 + axis] = pNormal[axis] * inverseLength;
+                    }
+                }
+            }
+
+            std::vector<float> const& normals = generateNormals ? task.m_generatedNormals : task.m_cornerNormals;
+
+            // Corner frames
+            //-------------------------------------------------------------------------
+
+            task.m_tangents.resize( numCorners * 4 );
+            task.m_binormals.resize( numCorners * 3 );
+
+            CornerBatch cornerBatch;
+            for ( size_t firstCorner = 0; firstCorner < numCorners; firstCorner += 4 )
+            {
+                size_t const numBatchCorners = std::min( numCorners - firstCorner, size_t( 4 ) );
+                memset( &cornerBatch, 0, sizeof( cornerBatch ) );
+
+                for ( size_t c = 0; c < numBatchCorners; c++ )
+                {
+                    size_t const cornerIdx = firstCorner + c;
+                    size_t const normalIdx = generateNormals ? (size_t) task.m_cornerControlPoints[cornerIdx] : cornerIdx;
+                    for ( int axis = 0; axis < 3; axis++ )
+                    {
+                        cornerBatch.m_normals[axis][c] = normals[normalIdx * 3 + axis];
+                        cornerBatch.m_tangents[axis][c] = vertexTangents[cornerVertices[cornerIdx] * 3 + axis];
+                        cornerBatch.m_bitangents[axis][c] = vertexBitangents[cornerVertices[cornerIdx] * 3 + axis];
+                    }
+                }
+
+                ComputeCornerFrames( cornerBatch );
+
+                for ( size_t c = 0; c < numBatchCorners; c++ )
+                {
+                    size_t const cornerIdx = firstCorner + c;
+                    for ( int axis = 0; axis < 4; axis++ )
+                    {
+                        task.m_tangents[cornerIdx * 4 + axis] = cornerBatch.m_tangents[axis][c];
+                    }
+
+                    for ( int axis = 0; axis < 3; axis++ )
+                    {
+                        task.m_binormals[cornerIdx * 3 + axis] = cornerBatch.m_bitangents[axis][c];
+                    }
+                }
+            }
+
+            // Degenerate corners get an arbitrary tangent perpendicular to the normal, so that every corner ends up with a valid frame
+            //-------------------------------------------------------------------------
+
+            for ( size_t cornerIdx = 0; cornerIdx < numCorners; cornerIdx++ )
+            {
+                float* pTangent = &task.m_tangents[cornerIdx * 4];
+                if ( pTangent[0] != 0.0f || pTangent[1] != 0.0f || pTangent[2] != 0.0f )
+                {
+                    continue;
+                }
+
+                size_t const normalIdx = generateNormals ? (size_t) task.m_cornerControlPoints[cornerIdx] : cornerIdx;
+                float n[3] = { normals[normalIdx * 3], normals[normalIdx * 3 + 1], normals[normalIdx * 3 + 2] };
+                float const normalLengthSq = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+                if ( normalLengthSq > s_minLengthSq )
+                {
+                    float const inverseLength = 1.0f / sqrtf( normalLengthSq );
+                    n[0] *= inverseLength;
+                    n[1] *= inverseLength;
+                    n[2] *= inverseLength;
+                }
+                else
+                {
+                    n[0] = 0.0f;
+                    n[1] = 0.0f;
+                    n[2] = 1.0f;
+                }
+
+                // Start from the axis that is the least aligned with the normal
+                float t[3] = { 0.0f, 0.0f, 0.0f };
+                t[( fabsf( n[0] ) < 0.9f ) ? 0 : 1] = 1.0f;
+                float const normalDotTangent = n[0] * t[0] + n[1] * t[1] + n[2] * t[2];
+                for ( int axis = 0; axis < 3; axis++ )
+                {
+                    t[axis] -= n[axis] * normalDotTangent;
+                }
+
+                float const inverseTangentLength = 1.0f / sqrtf( t[0] * t[0] + t[1] * t[1] + t[2] * t[2] );
+                pTangent[0] = t[0] * inverseTangentLength;
+                pTangent[1] = t[1] * inverseTangentLength;
+                pTangent[2] = t[2] * inverseTangentLength;
+                pTangent[3] = 1.0f;
+
+                float* pBinormal = &task.m_binormals[cornerIdx * 3];
+                pBinormal[0] = n[1] * pTangent[2] - n[2] * pTangent[1];
+                pBinormal[1] = n[2] * pTangent[0] - n[0] * pTangent[2];
+                pBinormal[2] = n[0] * pTangent[1] - n[1] * pTangent[0];
+            }
+        }
+
+        //-------------------------------------------------------------------------
+        // SDK access, only on the calling thread
+        //-------------------------------------------------------------------------
+
+        // Resolves the mapping and reference modes of a layer element to an index into its direct array for each polygon vertex
+        template<typename T>
+        static bool GetCornerDirectIndices( FbxMesh* pMesh, FbxLayerElementTemplate<T>* pElement, std::vector<int>& outIndices )
+        {
+            int const numPolygons = pMesh->GetPolygonCount();
+            int const numCorners = pMesh->GetPolygonVertexCount();
+            int const* pCornerControlPoints = pMesh->GetPolygonVertices();
+
+            outIndices.resize( numCorners );
+            switch ( pElement->GetMappingMode() )
+            {
+                case FbxLayerElement::eByControlPoint:
+                {
+                    for ( int i = 0; i < numCorners; i++ )
+                    {
+                        outIndices[i] = pCornerControlPoints[i];
+                    }
+                }
+                break;
+
+                case FbxLayerElement::eByPolygonVertex:
+                {
+                    for ( int i = 0; i < numCorners; i++ )
+                    {
+                        outIndices[i] = i;
+                    }
+                }
+                break;
+
+                case FbxLayerElement::eByPolygon:
+                {
+                    for ( int polygonIdx = 0; polygonIdx < numPolygons; polygonIdx++ )
+                    {
+                        int const firstCorner = pMesh->GetPolygonVertexIndex( polygonIdx );
+                        int const polygonSize = pMesh->GetPolygonSize( polygonIdx );
+                        for ( int i = 0; i < polygonSize; i++ )
+                        {
+                            outIndices[firstCorner + i] = polygonIdx;
+                        }
+                    }
+                }
+                break;
+
+                case FbxLayerElement::eAllSame:
+                {
+                    std::fill( outIndices.begin(), outIndices.end(), 0 );
+                }
+                break;
+
+                default:
+                return false;
+            }
+
+            // The SDK treats eIndex as eIndexToDirect
+            if ( pElement->GetReferenceMode() != FbxLayerElement::eDirect )
+            {
+                FbxLayerElementArrayTemplate<int> const& indexArray = pElement->GetIndexArray();
+                int const numIndices = indexArray.GetCount();
+                for ( int& index : outIndices )
+                {
+                    if ( index < 0 || index >= numIndices )
+                    {
+                        return false;
+                    }
+
+                    index = indexArray.GetAt( index );
+                }
+            }
+
+            int const numValues = pElement->GetDirectArray().GetCount();
+            for ( int const index : outIndices )
+            {
+                if ( index < 0 || index >= numValues )
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        enum class GatherResult
+        {
+            Gathered,
+            NoUVs,
+            InvalidMesh,        // Unsupported UV mapping, or out of range UV or control point indices
+        };
+
+        static GatherResult GatherMesh( FbxMesh* pMesh, MeshTask& outTask )
+        {
+            outTask.m_pMesh = pMesh;
+
+            FbxGeometryElementUV* pUVs = ( pMesh->GetElementUVCount() > 0 ) ? pMesh->GetElementUV( 0 ) : nullptr;
+            if ( pUVs == nullptr )
+            {
+                return GatherResult::NoUVs;
+            }
+
+            std::vector<int> directIndices;
+            if ( !GetCornerDirectIndices( pMesh, pUVs, directIndices ) )
+            {
+                return GatherResult::InvalidMesh;
+            }
+
+            int const numCorners = pMesh->GetPolygonVertexCount();
+            outTask.m_cornerUVs.resize( numCorners * 2 );
+            FbxLayerElementArrayTemplate<FbxVector2> const& uvArray = pUVs->GetDirectArray();
+            for ( int i = 0; i < numCorners; i++ )
+            {
+                FbxVector2 const uv = uvArray.GetAt( directIndices[i] );
+                outTask.m_cornerUVs[i * 2] = (float) uv[0];
+                outTask.m_cornerUVs[i * 2 + 1] = (float) uv[1];
+            }
+
+            // Normals that can't be resolved are treated as missing and get regenerated
+            FbxGeometryElementNormal* pNormals = ( pMesh->GetElementNormalCount() > 0 ) ? pMesh->GetElementNormal( 0 ) : nullptr;
+            if ( pNormals != nullptr && GetCornerDirectIndices( pMesh, pNormals, directIndices ) )
+            {
+                outTask.m_cornerNormals.resize( numCorners * 3 );
+                FbxLayerElementArrayTemplate<FbxVector4> const& normalArray = pNormals->GetDirectArray();
+                for ( int i = 0; i < numCorners; i++ )
+                {
+                    FbxVector4 const normal = normalArray.GetAt( directIndices[i] );
+                    outTask.m_cornerNormals[i * 3] = (float) normal[0];
+                    outTask.m_cornerNormals[i * 3 + 1] = (float) normal[1];
+                    outTask.m_cornerNormals[i * 3 + 2] = (float) normal[2];
+                }
+            }
+
+            //-------------------------------------------------------------------------
+
+            int const numControlPoints = pMesh->GetControlPointsCount();
+            FbxVector4 const* pControlPoints = pMesh->GetControlPoints();
+            outTask.m_controlPoints.resize( numControlPoints * 3 );
+            for ( int i = 0; i < numControlPoints; i++ )
+            {
+                outTask.m_controlPoints[i * 3] = (float) pControlPoints[i][0];
+                outTask.m_controlPoints[i * 3 + 1] = (float) pControlPoints[i][1];
+                outTask.m_controlPoints[i * 3 + 2] = (float) pControlPoints[i][2];
+            }
+
+            int const* pCornerControlPoints = pMesh->GetPolygonVertices();
+            outTask.m_cornerControlPoints.assign( pCornerControlPoints, pCornerControlPoints + numCorners );
+            for ( int const controlPointIdx : outTask.m_cornerControlPoints )
+            {
+                if ( controlPointIdx < 0 || controlPointIdx >= numControlPoints )
+                {
+                    return GatherResult::InvalidMesh;
+                }
+            }
+
+            int const numPolygons = pMesh->GetPolygonCount();
+            outTask.m_triangleCorners.reserve( numCorners * 3 );
+            for ( int polygonIdx = 0; polygonIdx < numPolygons; polygonIdx++ )
+            {
+                int const firstCorner = pMesh->GetPolygonVertexIndex( polygonIdx );
+                int const polygonSize = pMesh->GetPolygonSize( polygonIdx );
+                for ( int i = 1; i < polygonSize - 1; i++ )
+                {
+                    outTask.m_triangleCorners.push_back( firstCorner );
+                    outTask.m_triangleCorners.push_back( firstCorner + i );
+                    outTask.m_triangleCorners.push_back( firstCorner + i + 1 );
+                }
+            }
+
+            return GatherResult::Gathered;
+        }
+
+        // Existing tangent, binormal and normal elements are overwritten rather than added to, so processing a file twice gives the same result
+        static void WriteMesh( MeshTask const& task )
+        {
+            FbxMesh* pMesh = task.m_pMesh;
+            int const numCorners = (int) task.m_cornerControlPoints.size();
+
+            FbxGeometryElementTangent* pTangents = ( pMesh->GetElementTangentCount() > 0 ) ? pMesh->GetElementTangent( 0 ) : pMesh->CreateElementTangent();
+            pTangents->SetMappingMode( FbxLayerElement::eByPolygonVertex );
+            pTangents->SetReferenceMode( FbxLayerElement::eDirect );
+            pTangents->GetIndexArray().Clear();
+            pTangents->GetDirectArray().Resize( numCorners );
+
+            FbxVector4* pTangentData = pTangents->GetDirectArray().GetLocked( FbxLayerElementArray::eWriteLock );
+            for ( int i = 0; i < numCorners; i++ )
+            {
+                float const* pTangent = &task.m_tangents[i * 4];
+                pTangentData[i] = FbxVector4( pTangent[0], pTangent[1], pTangent[2], pTangent[3] );
+            }
+            pTangents->GetDirectArray().Release( &pTangentData );
+
+            FbxGeometryElementBinormal* pBinormals = ( pMesh->GetElementBinormalCount() > 0 ) ? pMesh->GetElementBinormal( 0 ) : pMesh->CreateElementBinormal();
+            pBinormals->SetMappingMode( FbxLayerElement::eByPolygonVertex );
+            pBinormals->SetReferenceMode( FbxLayerElement::eDirect );
+            pBinormals->GetIndexArray().Clear();
+            pBinormals->GetDirectArray().Resize( numCorners );
+
+            FbxVector4* pBinormalData = pBinormals->GetDirectArray().GetLocked( FbxLayerElementArray::eWriteLock );
+            for ( int i = 0; i < numCorners; i++ )
+            {
+                float const* pBinormal = &task.m_binormals[i * 3];
+                pBinormalData[i] = FbxVector4( pBinormal[0], pBinormal[1], pBinormal[2] );
+            }
+            pBinormals->GetDirectArray().Release( &pBinormalData );
+
+            //-------------------------------------------------------------------------
+
+            if ( !task.m_generatedNormals.empty() )
+            {
+                int const numControlPoints = (int) task.m_generatedNormals.size() / 3;
+                FbxGeometryElementNormal* pNormals = ( pMesh->GetElementNormalCount() > 0 ) ? pMesh->GetElementNormal( 0 ) : pMesh->CreateElementNormal();
+                pNormals->SetMappingMode( FbxLayerElement::eByControlPoint );
+                pNormals->SetReferenceMode( FbxLayerElement::eDirect );
+                pNormals->GetIndexArray().Clear();
+                pNormals->GetDirectArray().Resize( numControlPoints );
+
+                FbxVector4* pNormalData = pNormals->GetDirectArray().GetLocked( FbxLayerElementArray::eWriteLock );
+                for ( int i = 0; i < numControlPoints; i++ )
+                {
+                    float const* pNormal = &task.m_generatedNormals[i * 3];
+                    pNormalData[i] = FbxVector4( pNormal[0], pNormal[1], pNormal[2] );
+                }
+                pNormals->GetDirectArray().Release( &pNormalData );
+            }
+        }
+
+        //-------------------------------------------------------------------------
+
+        static void TriangulateMeshes( FbxScene* pScene, Results& outResults )
+        {
+            // Triangulating replaces the mesh, so the meshes need to be collected first
+            std::vector<FbxMesh*> meshes;
+            int const numMeshes = pScene->GetSrcObjectCount<FbxMesh>();
+            for ( int i = 0; i < numMeshes; i++ )
+            {
+                FbxMesh* pMesh = pScene->GetSrcObject<FbxMesh>( i );
+                if ( !pMesh->IsTriangleMesh() )
+                {
+                    meshes.emplace_back( pMesh );
+                }
+            }
+
+            if ( meshes.empty() )
+            {
+                return;
+            }
+
+            FbxGeometryConverter geometryConverter( pScene->GetFbxManager() );
+            for ( FbxMesh* pMesh : meshes )
+            {
+                if ( geometryConverter.Triangulate( pMesh, true ) != nullptr )
+                {
+                    outResults.m_numTriangulatedMeshes++;
+                }
+                else
+                {
+                    outResults.m_numFailedTriangulations++;
+                }
+            }
+        }
+
+        static void GenerateTangents( FbxScene* pScene, int numThreads, Results& outResults )
+        {
+            int const numMeshes = pScene->GetSrcObjectCount<FbxMesh>();
+            int nextMeshIdx = 0;
+            while ( nextMeshIdx < numMeshes )
+            {
+                // Gather
+                //-------------------------------------------------------------------------
+
+                std::vector<MeshTask> tasks;
+                size_t numBatchCorners = 0;
+                while ( nextMeshIdx < numMeshes && numBatchCorners < s_maxCornersPerBatch )
+                {
+                    FbxMesh* pMesh = pScene->GetSrcObject<FbxMesh>( nextMeshIdx++ );
+                    tasks.emplace_back();
+                    GatherResult const result = GatherMesh( pMesh, tasks.back() );
+                    if ( result != GatherResult::Gathered )
+                    {
+                        tasks.pop_back();
+                        if ( result == GatherResult::NoUVs )
+                        {
+                            outResults.m_numMeshesWithoutUVs++;
+                        }
+                        else
+                        {
+                            outResults.m_numInvalidMeshes++;
+                        }
+
+                        continue;
+                    }
+
+                    numBatchCorners += tasks.back().m_cornerControlPoints.size();
+                }
+
+                // Compute
+                //-------------------------------------------------------------------------
+
+                std::atomic<size_t> nextTaskIdx( 0 );
+                auto ComputeTasks = [&tasks, &nextTaskIdx] ()
+                {
+                    size_t taskIdx = 0;
+                    while ( ( taskIdx = nextTaskIdx++ ) < tasks.size() )
+                    {
+                        ComputeTangents( tasks[taskIdx] );
+                    }
+                };
+
+                std::vector<std::thread> threads;
+                int const numWorkers = std::min( numThreads, (int) tasks.size() );
+                for ( int i = 1; i < numWorkers; i++ )
+                {
+                    threads.emplace_back( ComputeTasks );
+                }
+
+                ComputeTasks();
+
+                for ( auto& thread : threads )
+                {
+                    thread.join();
+                }
+
+                // Write back
+                //-------------------------------------------------------------------------
+
+                for ( MeshTask const& task : tasks )
+                {
+                    WriteMesh( task );
+                    outResults.m_numTangentMeshes++;
+                    if ( !task.m_generatedNormals.empty() )
+                    {
+                        outResults.m_numGeneratedNormals++;
+                    }
+                }
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------
+
+    void ProcessScene( FbxScene* pScene, Settings const& settings, Results& outResults )
+    {
+        assert( pScene != nullptr );
+        outResults = Results();
+
+        if ( settings.m_triangulate )
+        {
+            TriangulateMeshes( pScene, outResults );
+        }
+
+        if ( settings.m_generateTangents )
+        {
+            GenerateTangents( pScene, std::max( 1, settings.m_numThreads ), outResults );
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <fbxsdk.h>
+
+//-------------------------------------------------------------------------
+// Optional mesh processing done once at conversion time, so that it doesn't need to be done every time the file is loaded.
+// Triangulation goes through the SDK's FbxGeometryConverter. Tangents and binormals (and normals for meshes that have none) are computed
+// with SSE kernels on multiple threads: the SDK isn't thread safe, so the mesh data is gathered and written back on the calling thread and
+// only the computation runs in parallel.
+//-------------------------------------------------------------------------
+
+namespace MeshProcessing
+{
+    struct Settings
+    {
+        inline bool IsActive() const { return m_triangulate || m_generateTangents; }
+
+    public:
+
+        bool                        m_triangulate = false;
+        bool                        m_generateTangents = false;     // Uses the first UV set, meshes without UVs are skipped
+        int                         m_numThreads = 1;
+    };
+
+    struct Results
+    {
+        int                         m_numTriangulatedMeshes = 0;
+        int                         m_numFailedTriangulations = 0;
+        int                         m_numTangentMeshes = 0;
+        int                         m_numMeshesWithoutUVs = 0;      // No tangents were generated
+        int                         m_numInvalidMeshes = 0;         // Unsupported UV mapping or invalid indices, no tangents were generated
+        int                         m_numGeneratedNormals = 0;      // Meshes that had no normals
+    };
+
+    void ProcessScene( FbxScene* pScene, Settings const& settings, Results& outResults );
+}
@@ -0,0 +1,546 @@
+#include "SceneFilter.h"
+#include <assert.h>
+#include <ctype.h>
+#include <string.h>
+#include <set>
+
+//-------------------------------------------------------------------------
+
+char const* const SceneFilter::s_nodeTypes[] = { "mesh", "skeleton", "camera", "light", "null", "other", nullptr };
+char const* const SceneFilter::s_contentTypes[] = { "material", "texture", "animation", "shape", "skin", "constraint", "character", nullptr };
+
+//-------------------------------------------------------------------------
+
+namespace
+{
+    static bool IsInList( char const* const* pList, char const* pTypeName )
+    {
+        for ( ; *pList != nullptr; pList++ )
+        {
+            if ( strcmp( *pList, pTypeName ) == 0 )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static bool ContainsTypeFromList( std::vector<std::string> const& types, char const* const* pList )
+    {
+        for ( auto const& type : types )
+        {
+            if ( IsInList( pList, type.c_str() ) )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static bool ContainsType( std::vector<std::string> const& types, char const* pTypeName )
+    {
+        for ( auto const& type : types )
+        {
+            if ( type == pTypeName )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Case insensitive wildcard match supporting '*' and '?'
+    static bool MatchesPattern( char const* pName, char const* pPattern, char const* pPatternEnd )
+    {
+        char const* pStarPattern = nullptr;
+        char const* pStarName = nullptr;
+
+        while ( *pName != 0 )
+        {
+            if ( pPattern < pPatternEnd && *pPattern == '*' )
+            {
+                pStarPattern = ++pPattern;
+                pStarName = pName;
+            }
+            else if ( pPattern < pPatternEnd && ( *pPattern == '?' || tolower( (unsigned char) *pPattern ) == tolower( (unsigned char) *pName ) ) )
+            {
+                pPattern++;
+                pName++;
+            }
+            else if ( pStarPattern != nullptr )
+            {
+                pPattern = pStarPattern;
+                pName = ++pStarName;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        while ( pPattern < pPatternEnd && *pPattern == '*' )
+        {
+            pPattern++;
+        }
+
+        return pPattern == pPatternEnd;
+    }
+
+    static bool MatchesAnyPattern( char const* pName, std::string const& patterns )
+    {
+        char const* pPattern = patterns.c_str();
+        while ( *pPattern != 0 )
+        {
+            char const* pPatternEnd = strchr( pPattern, ';' );
+            if ( pPatternEnd == nullptr )
+            {
+                pPatternEnd = pPattern + strlen( pPattern );
+            }
+
+            if ( pPatternEnd != pPattern && MatchesPattern( pName, pPattern, pPatternEnd ) )
+            {
+                return true;
+            }
+
+            pPattern = ( *pPatternEnd == ';' ) ? pPatternEnd + 1 : pPatternEnd;
+        }
+
+        return false;
+    }
+
+    static char const* GetNodeTypeName( FbxNode* pNode )
+    {
+        FbxNodeAttribute* pAttribute = pNode->GetNodeAttribute();
+        if ( pAttribute == nullptr )
+        {
+            return "null";
+        }
+
+        switch ( pAttribute->GetAttributeType() )
+        {
+            case FbxNodeAttribute::eNull: return "null";
+            case FbxNodeAttribute::eMesh: return "mesh";
+            case FbxNodeAttribute::eSkeleton: return "skeleton";
+            case FbxNodeAttribute::eCamera: return "camera";
+            case FbxNodeAttribute::eLight: return "light";
+            default: return "other";
+        }
+    }
+
+    //-------------------------------------------------------------------------
+
+    static void DestroyAnimCurveNode( FbxAnimCurveNode* pCurveNode )
+    {
+        std::vector<FbxAnimCurve*> curves;
+        unsigned int const numChannels = pCurveNode->GetChannelsCount();
+        for ( unsigned int channelIdx = 0; channelIdx < numChannels; channelIdx++ )
+        {
+            int const numCurves = pCurveNode->GetCurveCount( channelIdx );
+            for ( int curveIdx = 0; curveIdx < numCurves; curveIdx++ )
+            {
+                curves.emplace_back( pCurveNode->GetCurve( channelIdx, curveIdx ) );
+            }
+        }
+
+        pCurveNode->Destroy();
+
+        for ( auto pCurve : curves )
+        {
+            if ( pCurve != nullptr && pCurve->GetDstObjectCount<FbxAnimCurveNode>() == 0 )
+            {
+                pCurve->Destroy();
+            }
+        }
+    }
+
+    static void DestroyAnimStack( FbxAnimStack* pAnimStack )
+    {
+        for ( int layerIdx = pAnimStack->GetMemberCount<FbxAnimLayer>() - 1; layerIdx >= 0; layerIdx-- )
+        {
+            FbxAnimLayer* pAnimLayer = pAnimStack->GetMember<FbxAnimLayer>( layerIdx );
+            for ( int curveNodeIdx = pAnimLayer->GetMemberCount<FbxAnimCurveNode>() - 1; curveNodeIdx >= 0; curveNodeIdx-- )
+            {
+                DestroyAnimCurveNode( pAnimLayer->GetMember<FbxAnimCurveNode>( curveNodeIdx ) );
+            }
+
+            pAnimLayer->Destroy();
+        }
+
+        pAnimStack->Destroy();
+    }
+
+    static void DestroyDeformers( FbxGeometry* pGeometry )
+    {
+        for ( int deformerIdx = pGeometry->GetDeformerCount() - 1; deformerIdx >= 0; deformerIdx-- )
+        {
+            FbxDeformer* pDeformer = pGeometry->GetDeformer( deformerIdx );
+            if ( pDeformer->GetDeformerType() == FbxDeformer::eSkin )
+            {
+                FbxSkin* pSkin = static_cast<FbxSkin*>( pDeformer );
+                for ( int clusterIdx = pSkin->GetClusterCount() - 1; clusterIdx >= 0; clusterIdx-- )
+                {
+                    pSkin->GetCluster( clusterIdx )->Destroy();
+                }
+            }
+            else if ( pDeformer->GetDeformerType() == FbxDeformer::eBlendShape )
+            {
+                FbxBlendShape* pBlendShape = static_cast<FbxBlendShape*>( pDeformer );
+                for ( int channelIdx = pBlendShape->GetBlendShapeChannelCount() - 1; channelIdx >= 0; channelIdx-- )
+                {
+                    FbxBlendShapeChannel* pChannel = pBlendShape->GetBlendShapeChannel( channelIdx );
+                    for ( int shapeIdx = pChannel->GetTargetShapeCount() - 1; shapeIdx >= 0; shapeIdx-- )
+                    {
+                        pChannel->GetTargetShape( shapeIdx )->Destroy();
+                    }
+
+                    pChannel->Destroy();
+                }
+            }
+
+            pDeformer->Destroy();
+        }
+    }
+
+    // Destroys the node and its children, node attributes are destroyed once no other node uses them
+    static void DestroyNodeHierarchy( FbxScene* pScene, FbxNode* pNode )
+    {
+        for ( int childIdx = pNode->GetChildCount() - 1; childIdx >= 0; childIdx-- )
+        {
+            DestroyNodeHierarchy( pScene, pNode->GetChild( childIdx ) );
+        }
+
+        // Poses keep a list of nodes, so make sure we don't leave stale entries behind
+        for ( int poseIdx = 0; poseIdx < pScene->GetPoseCount(); poseIdx++ )
+        {
+            FbxPose* pPose = pScene->GetPose( poseIdx );
+            int const poseNodeIdx = pPose->Find( pNode );
+            if ( poseNodeIdx >= 0 )
+            {
+                pPose->Remove( poseNodeIdx );
+            }
+        }
+
+        FbxNodeAttribute* pAttribute = pNode->GetNodeAttribute();
+        pNode->Destroy();
+
+        if ( pAttribute != nullptr && pAttribute->GetNodeCount() == 0 )
+        {
+            FbxGeometry* pGeometry = FbxCast<FbxGeometry>( pAttribute );
+            if ( pGeometry != nullptr )
+            {
+                DestroyDeformers( pGeometry );
+            }
+
+            pAttribute->Destroy();
+        }
+    }
+
+    // Returns true if the node is kept. Nodes are kept if they pass both the name and type filters, or if any of their children are kept.
+    // Including a node by name includes its whole hierarchy, excluding a node by name excludes its whole hierarchy.
+    static bool GatherKeptNodes( SceneFilter const& filter, FbxNode* pNode, bool isInIncludedHierarchy, std::set<FbxNode*>& keptNodes )
+    {
+        if ( filter.IsNodeNameExcluded( pNode->GetName() ) )
+        {
+            return false;
+        }
+
+        bool const isNameIncluded = isInIncludedHierarchy || filter.IsNodeNameIncluded( pNode->GetName() );
+
+        bool hasKeptChildren = false;
+        for ( int childIdx = 0; childIdx < pNode->GetChildCount(); childIdx++ )
+        {
+            hasKeptChildren |= GatherKeptNodes( filter, pNode->GetChild( childIdx ), isNameIncluded, keptNodes );
+        }
+
+        if ( hasKeptChildren || ( isNameIncluded && filter.IsTypeIncluded( GetNodeTypeName( pNode ) ) ) )
+        {
+            keptNodes.insert( pNode );
+            return true;
+        }
+
+        return false;
+    }
+
+    // Skinned meshes reference nodes outside of their own hierarchy (i.e. the skeleton), so the linked nodes and their parents are kept along with the mesh
+    // regardless of the filters, otherwise the skin would end up bound to nothing. Linked nodes can be skinned meshes themselves, so we repeat until nothing new is added.
+    static void AddLinkedNodes( FbxScene* pScene, std::set<FbxNode*>& keptNodes )
+    {
+        std::vector<FbxNode*> nodesToVisit( keptNodes.begin(), keptNodes.end() );
+        while ( !nodesToVisit.empty() )
+        {
+            FbxNode* pNode = nodesToVisit.back();
+            nodesToVisit.pop_back();
+
+            FbxGeometry* pGeometry = FbxCast<FbxGeometry>( pNode->GetNodeAttribute() );
+            if ( pGeometry == nullptr )
+            {
+                continue;
+            }
+
+            for ( int deformerIdx = 0; deformerIdx < pGeometry->GetDeformerCount(); deformerIdx++ )
+            {
+                FbxDeformer* pDeformer = pGeometry->GetDeformer( deformerIdx );
+                if ( pDeformer->GetDeformerType() != FbxDeformer::eSkin )
+                {
+                    continue;
+                }
+
+                FbxSkin* pSkin = static_cast<FbxSkin*>( pDeformer );
+                for ( int clusterIdx = 0; clusterIdx < pSkin->GetClusterCount(); clusterIdx++ )
+                {
+                    FbxCluster* pCluster = pSkin->GetCluster( clusterIdx );
+                    for ( FbxNode* pLinkedNode : { pCluster->GetLink(), pCluster->GetAssociateModel() } )
+                    {
+                        // Kept nodes always have their parents kept, so we can stop at the first node that is already kept
+                        for ( ; pLinkedNode != nullptr && pLinkedNode != pScene->GetRootNode(); pLinkedNode = pLinkedNode->GetParent() )
+                        {
+                            if ( !keptNodes.insert( pLinkedNode ).second )
+                            {
+                                break;
+                            }
+
+                            nodesToVisit.emplace_back( pLinkedNode );
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Returns the number of removed hierarchies
+    static int DestroyRemovedNodes( FbxScene* pScene, FbxNode* pNode, std::set<FbxNode*> const& keptNodes )
+    {
+        if ( keptNodes.find( pNode ) == keptNodes.end() )
+        {
+            DestroyNodeHierarchy( pScene, pNode );
+            return 1;
+        }
+
+        int numRemovedHierarchies = 0;
+        for ( int childIdx = pNode->GetChildCount() - 1; childIdx >= 0; childIdx-- )
+        {
+            numRemovedHierarchies += DestroyRemovedNodes( pScene, pNode->GetChild( childIdx ), keptNodes );
+        }
+
+        return numRemovedHierarchies;
+    }
+
+    static void DestroyUnreferencedObjects( SceneFilter const& filter, FbxScene* pScene )
+    {
+        // Animation of nodes that have been removed
+        for ( int i = pScene->GetSrcObjectCount<FbxAnimCurveNode>() - 1; i >= 0; i-- )
+        {
+            FbxAnimCurveNode* pCurveNode = pScene->GetSrcObject<FbxAnimCurveNode>( i );
+            if ( pCurveNode->GetDstPropertyCount() == 0 )
+            {
+                DestroyAnimCurveNode( pCurveNode );
+            }
+        }
+
+        // Materials that are excluded or no longer used by any node
+        bool const areMaterialsIncluded = filter.IsTypeIncluded( "material" );
+        for ( int i = pScene->GetMaterialCount() - 1; i >= 0; i-- )
+        {
+            FbxSurfaceMaterial* pMaterial = pScene->GetMaterial( i );
+            if ( !areMaterialsIncluded || pMaterial->GetDstObjectCount<FbxNode>() == 0 )
+            {
+                pMaterial->Destroy();
+            }
+        }
+
+        // Textures that are excluded or no longer used by any material
+        bool const areTexturesIncluded = filter.IsTypeIncluded( "texture" );
+        for ( int i = pScene->GetTextureCount() - 1; i >= 0; i-- )
+        {
+            FbxTexture* pTexture = pScene->GetTexture( i );
+            if ( !areTexturesIncluded || ( pTexture->GetDstPropertyCount() == 0 && pTexture->GetDstObjectCount<FbxLayeredTexture>() == 0 ) )
+            {
+                pTexture->Destroy();
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+
+void SceneFilter::SplitList( std::string const& list, std::vector<std::string>& outItems )
+{
+    outItems.clear();
+
+    std::string item;
+    for ( size_t i = 0; i <= list.length(); i++ )
+    {
+        char const c = ( i < list.length() ) ? list[i] : ';';
+        if ( c == ';' || c == ',' )
+        {
+            if ( !item.empty() )
+            {
+                outItems.emplace_back( item );
+                item.clear();
+            }
+        }
+        else if ( !isspace( (unsigned char) c ) )
+        {
+            item += (char) tolower( (unsigned char) c );
+        }
+    }
+}
+
+bool SceneFilter::IsActive() const
+{
+    return !m_includedNodes.empty() || !m_excludedNodes.empty() || !m_includedAnimStacks.empty() || !m_excludedAnimStacks.empty() || !m_includedTypes.empty() || !m_excludedTypes.empty();
+}
+
+bool SceneFilter::Validate( std::string& errorMessage ) const
+{
+    for ( auto const* pTypes : { &m_includedTypes, &m_excludedTypes } )
+    {
+        for ( auto const& type : *pTypes )
+        {
+            if ( !IsInList( s_nodeTypes, type.c_str() ) && !IsInList( s_contentTypes, type.c_str() ) )
+            {
+                errorMessage = "Unknown type '" + type + "'. Supported types are:";
+                for ( auto const* pList : { s_nodeTypes, s_contentTypes } )
+                {
+                    for ( ; *pList != nullptr; pList++ )
+                    {
+                        errorMessage += " ";
+                        errorMessage += *pList;
+                    }
+                }
+
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool SceneFilter::IsNodeNameIncluded( char const* pName ) const
+{
+    return m_includedNodes.empty() || MatchesAnyPattern( pName, m_includedNodes );
+}
+
+bool SceneFilter::IsNodeNameExcluded( char const* pName ) const
+{
+    return !m_excludedNodes.empty() && MatchesAnyPattern( pName, m_excludedNodes );
+}
+
+// An include list only restricts the category (node or content) of the types it contains, so "-include-types mesh" keeps the materials of the meshes
+bool SceneFilter::IsTypeIncluded( char const* pTypeName ) const
+{
+    if ( ContainsType( m_excludedTypes, pTypeName ) )
+    {
+        return false;
+    }
+
+    char const* const* pCategory = IsInList( s_nodeTypes, pTypeName ) ? s_nodeTypes : s_contentTypes;
+    if ( ContainsTypeFromList( m_includedTypes, pCategory ) )
+    {
+        return ContainsType( m_includedTypes, pTypeName );
+    }
+
+    return true;
+}
+
+bool SceneFilter::IsAnimStackIncluded( char const* pName ) const
+{
+    if ( !IsTypeIncluded( "animation" ) )
+    {
+        return false;
+    }
+
+    if ( !m_excludedAnimStacks.empty() && MatchesAnyPattern( pName, m_excludedAnimStacks ) )
+    {
+        return false;
+    }
+
+    return m_includedAnimStacks.empty() || MatchesAnyPattern( pName, m_includedAnimStacks );
+}
+
+void SceneFilter::ApplyImportSettings( FbxIOSettings* pIOSettings ) const
+{
+    assert( pIOSettings != nullptr );
+
+    // Always set all the flags since the settings are shared between conversions
+    pIOSettings->SetBoolProp( IMP_FBX_MATERIAL, IsTypeIncluded( "material" ) );
+    pIOSettings->SetBoolProp( IMP_FBX_TEXTURE, IsTypeIncluded( "texture" ) );
+    pIOSettings->SetBoolProp( IMP_FBX_ANIMATION, IsTypeIncluded( "animation" ) );
+    pIOSettings->SetBoolProp( IMP_FBX_SHAPE, IsTypeIncluded( "shape" ) );
+    pIOSettings->SetBoolProp( IMP_FBX_LINK, IsTypeIncluded( "skin" ) );
+    pIOSettings->SetBoolProp( IMP_FBX_CONSTRAINT, IsTypeIncluded( "constraint" ) );
+    pIOSettings->SetBoolProp( IMP_FBX_CHARACTER, IsTypeIncluded( "character" ) );
+}
+
+void SceneFilter::SelectAnimStacks( FbxImporter* pImporter ) const
+{
+    assert( pImporter != nullptr );
+
+    int const numAnimStacks = pImporter->GetAnimStackCount();
+    for ( int i = 0; i < numAnimStacks; i++ )
+    {
+        FbxTakeInfo* pTakeInfo = pImporter->GetTakeInfo( i );
+        if ( pTakeInfo != nullptr )
+        {
+            pTakeInfo->mSelect = IsAnimStackIncluded( pTakeInfo->mName.Buffer() );
+        }
+    }
+}
+
+void SceneFilter::PruneScene( FbxScene* pScene ) const
+{
+    assert( pScene != nullptr );
+
+    if ( !IsActive() )
+    {
+        return;
+    }
+
+    // Anim stacks
+    //-------------------------------------------------------------------------
+    // The importer should already have skipped the deselected takes, but not all readers support this
+
+    for ( int i = pScene->GetSrcObjectCount<FbxAnimStack>() - 1; i >= 0; i-- )
+    {
+        FbxAnimStack* pAnimStack = pScene->GetSrcObject<FbxAnimStack>( i );
+        if ( !IsAnimStackIncluded( pAnimStack->GetName() ) )
+        {
+            pScene->RemoveTakeInfo( pAnimStack->GetName() );
+            DestroyAnimStack( pAnimStack );
+        }
+    }
+
+    if ( pScene->GetSrcObjectCount<FbxAnimStack>() > 0 )
+    {
+        pScene->SetCurrentAnimationStack( pScene->GetSrcObject<FbxAnimStack>( 0 ) );
+    }
+
+    // Nodes
+    //-------------------------------------------------------------------------
+
+    FbxNode* pRootNode = pScene->GetRootNode();
+    std::set<FbxNode*> keptNodes;
+    for ( int i = 0; i < pRootNode->GetChildCount(); i++ )
+    {
+        GatherKeptNodes( *this, pRootNode->GetChild( i ), false, keptNodes );
+    }
+
+    AddLinkedNodes( pScene, keptNodes );
+
+    int numRemovedHierarchies = 0;
+    for ( int i = pRootNode->GetChildCount() - 1; i >= 0; i-- )
+    {
+        numRemovedHierarchies += DestroyRemovedNodes( pScene, pRootNode->GetChild( i ), keptNodes );
+    }
+
+    // Scanning the whole scene for unreferenced objects is only worth it when something could have been left unreferenced, removed anim stacks
+    // already take their curves with them
+    if ( numRemovedHierarchies > 0 || !IsTypeIncluded( "material" ) || !IsTypeIncluded( "texture" ) )
+    {
+        DestroyUnreferencedObjects( *this, pScene );
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <fbxsdk.h>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------
+// Selects which parts of a scene are converted.
+// Content types that the importer can skip (materials, animation, etc.) are never loaded, everything else is pruned from the scene before export.
+//-------------------------------------------------------------------------
+
+struct SceneFilter
+{
+    // The supported type names, node types are matched against the node attribute, content types map to the importer settings
+    static char const* const s_nodeTypes[];
+    static char const* const s_contentTypes[];
+
+    // Splits a semicolon or comma separated type list into lowercase type names
+    static void SplitList( std::string const& list, std::vector<std::string>& outItems );
+
+    //-------------------------------------------------------------------------
+
+    bool IsActive() const;
+
+    // Checks that all the specified type names are supported
+    bool Validate( std::string& errorMessage ) const;
+
+    // Disables the import of the excluded content types, this needs to be called before initializing the importer
+    void ApplyImportSettings( FbxIOSettings* pIOSettings ) const;
+
+    // Deselects the excluded anim stacks so they are never loaded, this needs to be called after initializing the importer
+    void SelectAnimStacks( FbxImporter* pImporter ) const;
+
+    // Removes the excluded nodes, anim stacks and any data that is no longer referenced once they are gone
+    void PruneScene( FbxScene* pScene ) const;
+
+    bool IsNodeNameIncluded( char const* pName ) const;
+    bool IsNodeNameExcluded( char const* pName ) const;
+    bool IsTypeIncluded( char const* pTypeName ) const;
+    bool IsAnimStackIncluded( char const* pName ) const;
+
+public:
+
+    // Name patterns are semicolon separated and support the '*' and '?' wildcards, matching is case insensitive
+    std::string                 m_includedNodes;
+    std::string                 m_excludedNodes;
+    std::string                 m_includedAnimStacks;
+    std::string                 m_excludedAnimStacks;
+
+    // Type names are semicolon or comma separated
+    std::vector<std::string>    m_includedTypes;
+    std::vector<std::string>    m_excludedTypes;
+};
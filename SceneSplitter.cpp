@@ -0,0 +1,460 @@
+#include "SceneSplitter.h"
+#include "Compression.h"
+#include <assert.h>
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+#include <set>
+
+//-------------------------------------------------------------------------
+
+namespace SceneSplitter
+{
+    namespace
+    {
+        static bool ContainsMesh( FbxNode* pNode )
+        {
+            FbxNodeAttribute* pAttribute = pNode->GetNodeAttribute();
+            if ( pAttribute != nullptr && pAttribute->GetAttributeType() == FbxNodeAttribute::eMesh )
+            {
+                return true;
+            }
+
+            for ( int i = 0; i < pNode->GetChildCount(); i++ )
+            {
+                if ( ContainsMesh( pNode->GetChild( i ) ) )
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        static void GetMeshPieceRootNodes( FbxScene* pScene, std::vector<FbxNode*>& outNodes )
+        {
+            outNodes.clear();
+
+            FbxNode* pRootNode = pScene->GetRootNode();
+            for ( int i = 0; i < pRootNode->GetChildCount(); i++ )
+            {
+                FbxNode* pChildNode = pRootNode->GetChild( i );
+                if ( ContainsMesh( pChildNode ) )
+                {
+                    outNodes.emplace_back( pChildNode );
+                }
+            }
+        }
+
+        static FbxNode* GetTopLevelNode( FbxScene* pScene, FbxNode* pNode )
+        {
+            FbxNode* pRootNode = pScene->GetRootNode();
+            while ( pNode->GetParent() != nullptr && pNode->GetParent() != pRootNode )
+            {
+                pNode = pNode->GetParent();
+            }
+
+            return pNode;
+        }
+
+        static std::string MakeFileNameSafe( char const* pName )
+        {
+            std::string safeName;
+            for ( char const* pChar = pName; *pChar != 0; pChar++ )
+            {
+                unsigned char const c = (unsigned char) *pChar;
+                safeName += ( isalnum( c ) || c == '_' || c == '-' || c == '.' ) ? (char) c : '_';
+            }
+
+            return safeName.empty() ? "unnamed" : safeName;
+        }
+
+        static void GetAnimStackObjects( FbxAnimStack* pAnimStack, std::vector<FbxObject*>& outObjects, std::vector<FbxAnimCurveNode*>& outCurveNodes )
+        {
+            outObjects.emplace_back( pAnimStack );
+
+            for ( int layerIdx = 0; layerIdx < pAnimStack->GetMemberCount<FbxAnimLayer>(); layerIdx++ )
+            {
+                FbxAnimLayer* pAnimLayer = pAnimStack->GetMember<FbxAnimLayer>( layerIdx );
+                outObjects.emplace_back( pAnimLayer );
+
+                for ( int curveNodeIdx = 0; curveNodeIdx < pAnimLayer->GetMemberCount<FbxAnimCurveNode>(); curveNodeIdx++ )
+                {
+                    FbxAnimCurveNode* pCurveNode = pAnimLayer->GetMember<FbxAnimCurveNode>( curveNodeIdx );
+                    outObjects.emplace_back( pCurveNode );
+                    outCurveNodes.emplace_back( pCurveNode );
+
+                    unsigned int const numChannels = pCurveNode->GetChannelsCount();
+                    for ( unsigned int channelIdx = 0; channelIdx < numChannels; channelIdx++ )
+                    {
+                        int const numCurves = pCurveNode->GetCurveCount( channelIdx );
+                        for ( int curveIdx = 0; curveIdx < numCurves; curveIdx++ )
+                        {
+                            FbxAnimCurve* pCurve = pCurveNode->GetCurve( channelIdx, curveIdx );
+                            if ( pCurve != nullptr )
+                            {
+                                outObjects.emplace_back( pCurve );
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------
+
+    bool ParseSplitMode( std::string const& modeString, SplitMode& outMode )
+    {
+        if ( _stricmp( modeString.c_str(), "meshes" ) == 0 )
+        {
+            outMode = SplitMode::Meshes;
+            return true;
+        }
+
+        if ( _stricmp( modeString.c_str(), "stacks" ) == 0 )
+        {
+            outMode = SplitMode::AnimStacks;
+            return true;
+        }
+
+        return false;
+    }
+
+    char const* GetSplitModeDescription( SplitMode mode )
+    {
+        switch ( mode )
+        {
+            case SplitMode::Meshes: return "mesh hierarchies";
+            case SplitMode::AnimStacks: return "anim stacks";
+            default: return "nothing";
+        }
+    }
+
+    void GetPieceNames( FbxScene* pScene, SplitMode mode, std::vector<std::string>& outPieceNames )
+    {
+        assert( pScene != nullptr );
+        outPieceNames.clear();
+
+        if ( mode == SplitMode::Meshes )
+        {
+            std::vector<FbxNode*> pieceRootNodes;
+            GetMeshPieceRootNodes( pScene, pieceRootNodes );
+            for ( auto pNode : pieceRootNodes )
+            {
+                outPieceNames.emplace_back( MakeFileNameSafe( pNode->GetName() ) );
+            }
+        }
+        else if ( mode == SplitMode::AnimStacks )
+        {
+            int const numAnimStacks = pScene->GetSrcObjectCount<FbxAnimStack>();
+            for ( int i = 0; i < numAnimStacks; i++ )
+            {
+                outPieceNames.emplace_back( MakeFileNameSafe( pScene->GetSrcObject<FbxAnimStack>( i )->GetName() ) );
+            }
+        }
+
+        // Names only need to be unique per file, so we just number any duplicates (case insensitive since we're on windows)
+        std::set<std::string> usedNames;
+        for ( auto& pieceName : outPieceNames )
+        {
+            std::string lowercaseName = pieceName;
+            std::transform( lowercaseName.begin(), lowercaseName.end(), lowercaseName.begin(), [] ( char c ) { return (char) tolower( (unsigned char) c ); } );
+
+            std::string uniqueName = lowercaseName;
+            for ( int suffix = 2; usedNames.find( uniqueName ) != usedNames.end(); suffix++ )
+            {
+                uniqueName = lowercaseName + "_" + std::to_string( suffix );
+            }
+
+            if ( uniqueName != lowercaseName )
+            {
+                pieceName += uniqueName.substr( lowercaseName.length() );
+            }
+
+            usedNames.insert( uniqueName );
+        }
+    }
+
+    std::string GetPieceOutputPath( std::string const& outputFilepath, std::string const& pieceName )
+    {
+        std::string basePath = outputFilepath;
+        if ( Compression::HasCompressedFileExtension( basePath ) )
+        {
+            basePath.resize( basePath.length() - strlen( Compression::s_compressedFileExtension ) );
+        }
+
+        std::string extension = ".fbx";
+        size_t const extensionIdx = basePath.find_last_of( '.' );
+        size_t const separatorIdx = basePath.find_last_of( "\\/" );
+        if ( extensionIdx != std::string::npos && ( separatorIdx == std::string::npos || extensionIdx > separatorIdx ) )
+        {
+            extension = basePath.substr( extensionIdx );
+            basePath.resize( extensionIdx );
+        }
+
+        return basePath + "_" + pieceName + extension;
+    }
+
+    //-------------------------------------------------------------------------
+
+    ScenePiece::ScenePiece( FbxScene* pScene, SplitMode mode, int pieceIdx )
+        : m_pSourceScene( pScene )
+        , m_mode( mode )
+    {
+        assert( pScene != nullptr && pieceIdx >= 0 );
+
+        if ( mode == SplitMode::Meshes )
+        {
+            std::vector<FbxNode*> pieceRootNodes;
+            GetMeshPieceRootNodes( pScene, pieceRootNodes );
+            if ( pieceIdx < (int) pieceRootNodes.size() )
+            {
+                CreateMeshPieceScene( pieceRootNodes[pieceIdx] );
+            }
+        }
+        else if ( mode == SplitMode::AnimStacks )
+        {
+            if ( pieceIdx < pScene->GetSrcObjectCount<FbxAnimStack>() )
+            {
+                DetachOtherAnimStacks( pScene->GetSrcObject<FbxAnimStack>( pieceIdx ) );
+                m_pPieceScene = pScene;
+            }
+        }
+    }
+
+    ScenePiece::~ScenePiece()
+    {
+        if ( m_mode == SplitMode::Meshes && m_pPieceScene != nullptr )
+        {
+            m_pPieceScene->Destroy();
+        }
+        else if ( m_mode == SplitMode::AnimStacks )
+        {
+            ReattachAnimStacks();
+        }
+
+        m_pPieceScene = nullptr;
+    }
+
+    void ScenePiece::CreateMeshPieceScene( FbxNode* pPieceRootNode )
+    {
+        m_pPieceScene = FbxScene::Create( m_pSourceScene->GetFbxManager(), pPieceRootNode->GetName() );
+
+        FbxGlobalSettings const& sourceSettings = m_pSourceScene->GetGlobalSettings();
+        FbxGlobalSettings& pieceSettings = m_pPieceScene->GetGlobalSettings();
+        pieceSettings.SetAxisSystem( sourceSettings.GetAxisSystem() );
+        pieceSettings.SetSystemUnit( sourceSettings.GetSystemUnit() );
+        pieceSettings.SetTimeMode( sourceSettings.GetTimeMode() );
+        pieceSettings.SetCustomFrameRate( sourceSettings.GetCustomFrameRate() );
+        pieceSettings.SetAmbientColor( sourceSettings.GetAmbientColor() );
+
+        // Gather the piece hierarchy and its dependencies. Skinned meshes reference nodes in other hierarchies (i.e. the skeleton),
+        // so we keep adding the top-level hierarchies of any referenced nodes until nothing new is referenced.
+        //-------------------------------------------------------------------------
+
+        // Connections to objects outside of the clone set are dropped, otherwise the clones would be connected back into the source scene
+        FbxCloneManager::CloneSetElement const cloneOptions( FbxCloneManager::sConnectToClone, 0, FbxObject::eDeepClone );
+        FbxCloneManager::CloneSet cloneSet;
+
+        std::vector<FbxNode*> topLevelNodes = { pPieceRootNode };
+        for ( size_t i = 0; i < topLevelNodes.size(); i++ )
+        {
+            cloneSet.Insert( topLevelNodes[i], cloneOptions );
+            FbxCloneManager::AddDependents( cloneSet, topLevelNodes[i], cloneOptions );
+
+            for ( auto pRecord = cloneSet.Minimum(); pRecord != nullptr; pRecord = pRecord->Successor() )
+            {
+                FbxNode* pNode = FbxCast<FbxNode>( pRecord->GetKey() );
+                if ( pNode == nullptr || pNode == m_pSourceScene->GetRootNode() )
+                {
+                    continue;
+                }
+
+                FbxNode* pTopLevelNode = GetTopLevelNode( m_pSourceScene, pNode );
+                if ( std::find( topLevelNodes.begin(), topLevelNodes.end(), pTopLevelNode ) == topLevelNodes.end() )
+                {
+                    topLevelNodes.emplace_back( pTopLevelNode );
+                }
+            }
+        }
+
+        FbxCloneManager cloneManager;
+        if ( !cloneManager.Clone( cloneSet, m_pPieceScene ) )
+        {
+            m_pPieceScene->Destroy();
+            m_pPieceScene = nullptr;
+            return;
+        }
+
+        //-------------------------------------------------------------------------
+
+        FbxNode* pPieceSceneRootNode = m_pPieceScene->GetRootNode();
+        for ( auto pTopLevelNode : topLevelNodes )
+        {
+            FbxNode* pClonedNode = FbxCast<FbxNode>( cloneSet.Find( pTopLevelNode )->GetValue().mObjectClone );
+            pPieceSceneRootNode->AddChild( pClonedNode );
+        }
+
+        // Animation isn't part of the piece, so remove any curve nodes that were cloned along with the animated properties
+        for ( int i = m_pPieceScene->GetSrcObjectCount<FbxAnimCurveNode>() - 1; i >= 0; i-- )
+        {
+            FbxAnimCurveNode* pCurveNode = m_pPieceScene->GetSrcObject<FbxAnimCurveNode>( i );
+            if ( pCurveNode->GetDstObjectCount<FbxAnimLayer>() == 0 )
+            {
+                unsigned int const numChannels = pCurveNode->GetChannelsCount();
+                for ( unsigned int channelIdx = 0; channelIdx < numChannels; channelIdx++ )
+                {
+                    for ( int curveIdx = pCurveNode->GetCurveCount( channelIdx ) - 1; curveIdx >= 0; curveIdx-- )
+                    {
+                        FbxAnimCurve* pCurve = pCurveNode->GetCurve( channelIdx, curveIdx );
+                        if ( pCurve != nullptr )
+                        {
+                            pCurve->Destroy();
+                        }
+                    }
+                }
+
+                pCurveNode->Destroy();
+            }
+        }
+
+        // Poses aren't connected to the nodes they reference, so rebuild them from the cloned nodes
+        for ( int poseIdx = 0; poseIdx < m_pSourceScene->GetPoseCount(); poseIdx++ )
+        {
+            FbxPose* pSourcePose = m_pSourceScene->GetPose( poseIdx );
+            FbxPose* pPiecePose = nullptr;
+
+            for ( int i = 0; i < pSourcePose->GetCount(); i++ )
+            {
+                auto pRecord = cloneSet.Find( pSourcePose->GetNode( i ) );
+                if ( pRecord == nullptr )
+                {
+                    continue;
+                }
+
+                if ( pPiecePose == nullptr )
+                {
+                    pPiecePose = FbxPose::Create( m_pPieceScene, pSourcePose->GetName() );
+                    pPiecePose->SetIsBindPose( pSourcePose->IsBindPose() );
+                }
+
+                pPiecePose->Add( FbxCast<FbxNode>( pRecord->GetValue().mObjectClone ), pSourcePose->GetMatrix( i ), pSourcePose->IsLocalMatrix( i ) );
+            }
+
+            if ( pPiecePose != nullptr )
+            {
+                m_pPieceScene->AddPose( pPiecePose );
+            }
+        }
+    }
+
+    void ScenePiece::DetachOtherAnimStacks( FbxAnimStack* pAnimStack )
+    {
+        m_pPreviousAnimStack = m_pSourceScene->GetCurrentAnimationStack();
+
+        // Objects shared with the piece's anim stack need to stay in the scene
+        std::vector<FbxObject*> pieceObjects;
+        std::vector<FbxAnimCurveNode*> pieceCurveNodes;
+        GetAnimStackObjects( pAnimStack, pieceObjects, pieceCurveNodes );
+        std::set<FbxObject*> const sharedObjects( pieceObjects.begin(), pieceObjects.end() );
+
+        //-------------------------------------------------------------------------
+
+        // The exporter writes every object in the scene, so the other anim stacks, their layers, curve nodes and curves are all removed from the scene.
+        // The curve nodes are also disconnected from the properties they animate so we don't export connections to objects that don't exist.
+        for ( int stackIdx = 0; stackIdx < m_pSourceScene->GetSrcObjectCount<FbxAnimStack>(); stackIdx++ )
+        {
+            FbxAnimStack* pOtherAnimStack = m_pSourceScene->GetSrcObject<FbxAnimStack>( stackIdx );
+            if ( pOtherAnimStack == pAnimStack )
+            {
+                continue;
+            }
+
+            std::vector<FbxObject*> objects;
+            std::vector<FbxAnimCurveNode*> curveNodes;
+            GetAnimStackObjects( pOtherAnimStack, objects, curveNodes );
+
+            DetachedAnimStack detachedAnimStack;
+            for ( auto pObject : objects )
+            {
+                if ( sharedObjects.find( pObject ) == sharedObjects.end() )
+                {
+                    detachedAnimStack.m_objects.emplace_back( pObject );
+                }
+            }
+
+            for ( auto pCurveNode : curveNodes )
+            {
+                if ( sharedObjects.find( pCurveNode ) != sharedObjects.end() )
+                {
+                    continue;
+                }
+
+                for ( int propertyIdx = 0; propertyIdx < pCurveNode->GetDstPropertyCount(); propertyIdx++ )
+                {
+                    detachedAnimStack.m_propertyConnections.emplace_back( pCurveNode, pCurveNode->GetDstProperty( propertyIdx ) );
+                }
+            }
+
+            FbxTakeInfo* pTakeInfo = m_pSourceScene->GetTakeInfo( pOtherAnimStack->GetName() );
+            if ( pTakeInfo != nullptr )
+            {
+                detachedAnimStack.m_takeInfo = *pTakeInfo;
+                detachedAnimStack.m_hasTakeInfo = true;
+            }
+
+            m_detachedAnimStacks.emplace_back( detachedAnimStack );
+        }
+
+        //-------------------------------------------------------------------------
+
+        for ( auto const& detachedAnimStack : m_detachedAnimStacks )
+        {
+            for ( auto const& connection : detachedAnimStack.m_propertyConnections )
+            {
+                connection.first->DisconnectDstProperty( connection.second );
+            }
+
+            for ( auto pObject : detachedAnimStack.m_objects )
+            {
+                m_pSourceScene->DisconnectSrcObject( pObject );
+            }
+
+            if ( detachedAnimStack.m_hasTakeInfo )
+            {
+                m_pSourceScene->RemoveTakeInfo( detachedAnimStack.m_takeInfo.mName );
+            }
+        }
+
+        m_pSourceScene->SetCurrentAnimationStack( pAnimStack );
+    }
+
+    void ScenePiece::ReattachAnimStacks()
+    {
+        for ( auto const& detachedAnimStack : m_detachedAnimStacks )
+        {
+            for ( auto pObject : detachedAnimStack.m_objects )
+            {
+                m_pSourceScene->ConnectSrcObject( pObject );
+            }
+
+            for ( auto const& connection : detachedAnimStack.m_propertyConnections )
+            {
+                connection.first->ConnectDstProperty( connection.second );
+            }
+
+            if ( detachedAnimStack.m_hasTakeInfo )
+            {
+                m_pSourceScene->SetTakeInfo( detachedAnimStack.m_takeInfo );
+            }
+        }
+
+        m_detachedAnimStacks.clear();
+
+        if ( m_pPreviousAnimStack != nullptr )
+        {
+            m_pSourceScene->SetCurrentAnimationStack( m_pPreviousAnimStack );
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <fbxsdk.h>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------
+// Splits a scene into pieces that are each exported to their own file.
+// A piece is either a top-level node hierarchy that contains at least one mesh, or a single anim stack.
+// Piece indices are deterministic for a given file, so multiple imports of the same file can each export a different subset of the pieces.
+//-------------------------------------------------------------------------
+
+namespace SceneSplitter
+{
+    enum class SplitMode
+    {
+        None,
+        Meshes,
+        AnimStacks,
+    };
+
+    // Valid modes are "meshes" and "stacks"
+    bool ParseSplitMode( std::string const& modeString, SplitMode& outMode );
+
+    char const* GetSplitModeDescription( SplitMode mode );
+
+    // Returns the file name safe (and unique) names of all the pieces in the scene
+    void GetPieceNames( FbxScene* pScene, SplitMode mode, std::vector<std::string>& outPieceNames );
+
+    // "c:\out\kit.fbx" + "Chair" -> "c:\out\kit_Chair.fbx"
+    std::string GetPieceOutputPath( std::string const& outputFilepath, std::string const& pieceName );
+
+    //-------------------------------------------------------------------------
+
+    // Provides a scene that only contains the specified piece for the lifetime of this object.
+    // Mesh pieces are cloned into a new scene along with any other hierarchies they reference (i.e. the skeleton), animation is not included.
+    // Anim stack pieces temporarily detach all the other anim stacks from the source scene, so the source scene can't be used by anything else in the meantime.
+    class ScenePiece
+    {
+        struct DetachedAnimStack
+        {
+            std::vector<FbxObject*>                                     m_objects;
+            std::vector<std::pair<FbxAnimCurveNode*, FbxProperty>>      m_propertyConnections;
+            FbxTakeInfo                                                 m_takeInfo;
+            bool                                                        m_hasTakeInfo = false;
+        };
+
+    public:
+
+        ScenePiece( FbxScene* pScene, SplitMode mode, int pieceIdx );
+        ~ScenePiece();
+
+        // Returns null if the piece couldn't be created
+        inline FbxScene* GetScene() const { return m_pPieceScene; }
+
+    private:
+
+        ScenePiece( ScenePiece const& ) = delete;
+        ScenePiece& operator=( ScenePiece const& ) = delete;
+
+        void CreateMeshPieceScene( FbxNode* pPieceRootNode );
+        void DetachOtherAnimStacks( FbxAnimStack* pAnimStack );
+        void ReattachAnimStacks();
+
+    private:
+
+        FbxScene*                                                       m_pSourceScene = nullptr;
+        FbxScene*                                                       m_pPieceScene = nullptr;
+        SplitMode const                                                 m_mode = SplitMode::None;
+        FbxAnimStack*                                                   m_pPreviousAnimStack = nullptr;
+        std::vector<DetachedAnimStack>                                  m_detachedAnimStacks;
+    };
+}
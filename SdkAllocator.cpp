@@ -0,0 +1,567 @@
+#include "SdkAllocator.h"
+#include <fbxsdk.h>
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+//-------------------------------------------------------------------------
+// Every block is preceded by a 16 byte header that stores the slab it was allocated from, or null for blocks allocated from the default
+// handlers (large blocks, and all blocks in count mode). Keeping the header 16 bytes keeps the returned pointers 16 byte aligned.
+//
+// Each thread adopts its own pool on its first allocation. Pools hold a list of slabs per size class, and each slab hands out its blocks
+// by bumping a pointer and then by recycling its free list. Blocks freed by another thread than the owner (e.g. a scene created on the main
+// thread and destroyed on a worker) are pushed onto a lock free list of the owning pool, which the owner collects when it next allocates.
+//
+// Pools are never destroyed: when a thread exits its pool is returned to a free list and adopted by the next new thread, so blocks that
+// outlive their thread always have a valid pool to return to.
+//-------------------------------------------------------------------------
+
+namespace SdkAllocator
+{
+    namespace
+    {
+        struct ThreadPool;
+        struct Slab;
+
+        struct BlockHeader
+        {
+            Slab*                       m_pSlab;
+            union
+            {
+                uint64_t                m_size;             // Blocks from the default handlers
+                BlockHeader*            m_pNextFree;        // Free pool blocks
+            };
+        };
+
+        static_assert( sizeof( BlockHeader ) == 16, "The block header size needs to preserve the 16 byte alignment" );
+
+        struct Slab
+        {
+            ThreadPool*                 m_pPool;
+            Slab*                       m_pPrev;
+            Slab*                       m_pNext;
+            uint8_t*                    m_pBump;
+            uint8_t*                    m_pEnd;
+            BlockHeader*                m_pFreeList;
+            uint32_t                    m_classIdx;
+            uint32_t                    m_blockSize;        // Including the header
+            uint32_t                    m_numLiveBlocks;
+
+            inline bool HasFreeBlock() const { return m_pFreeList != nullptr || m_pBump + m_blockSize <= m_pEnd; }
+        };
+
+        static size_t const s_slabHeaderSize = ( sizeof( Slab ) + 15 ) & ~size_t( 15 );
+
+        //-------------------------------------------------------------------------
+
+        // 16 to 128 in steps of 16, then four classes per doubling up to 32KB
+        static size_t const s_maxPooledSize = 32 * 1024;
+        static size_t const s_numSizeClasses = 8 + 8 * 4;
+        static size_t const s_minSlabSize = 64 * 1024;
+        static size_t const s_minBlocksPerSlab = 8;
+
+        static uint32_t g_classSizes[s_numSizeClasses];
+        static uint8_t g_sizeToClass[( s_maxPooledSize >> 4 ) + 1];
+
+        static void InitializeSizeClasses()
+        {
+            size_t numClasses = 0;
+            for ( uint32_t size = 16; size <= 128; size += 16 )
+            {
+                g_classSizes[numClasses++] = size;
+            }
+
+            for ( uint32_t baseSize = 128; baseSize < s_maxPooledSize; baseSize *= 2 )
+            {
+                for ( uint32_t step = 1; step <= 4; step++ )
+                {
+                    g_classSizes[numClasses++] = baseSize + step * ( baseSize / 4 );
+                }
+            }
+
+            assert( numClasses == s_numSizeClasses && g_classSizes[s_numSizeClasses - 1] == s_maxPooledSize );
+
+            size_t classIdx = 0;
+            for ( size_t i = 0; i < sizeof( g_sizeToClass ); i++ )
+            {
+                while ( ( i << 4 ) > g_classSizes[classIdx] )
+                {
+                    classIdx++;
+                }
+
+                g_sizeToClass[i] = (uint8_t) classIdx;
+            }
+        }
+
+        //-------------------------------------------------------------------------
+
+        struct ThreadPool
+        {
+            Slab*                       m_slabs[s_numSizeClasses] = {};     // Slabs with free blocks always precede the full slabs
+            std::atomic<BlockHeader*>   m_remoteFrees = { nullptr };
+            ThreadPool*                 m_pNextUnused = nullptr;
+        };
+
+        struct ThreadStats
+        {
+            uint64_t                    m_numAllocations;
+            int64_t                     m_currentBytes;
+            int64_t                     m_peakBytes;
+        };
+
+        static Mode g_mode = Mode::Default;
+        static FbxMallocProc g_pDefaultMalloc = nullptr;
+        static FbxReallocProc g_pDefaultRealloc = nullptr;
+        static FbxFreeProc g_pDefaultFree = nullptr;
+
+        static std::mutex g_poolMutex;
+        static ThreadPool* g_pUnusedPools = nullptr;
+
+        // These are plain data so that they can be used at any point of the thread's lifetime
+        static thread_local ThreadPool* t_pPool = nullptr;
+        static thread_local bool t_isThreadExiting = false;
+        static thread_local ThreadStats t_stats = {};
+
+        //-------------------------------------------------------------------------
+
+        static inline void RecordAllocation( size_t size )
+        {
+            t_stats.m_numAllocations++;
+            t_stats.m_currentBytes += (int64_t) size;
+            t_stats.m_peakBytes = std::max( t_stats.m_peakBytes, t_stats.m_currentBytes );
+        }
+
+        static inline void RecordFree( size_t size )
+        {
+            t_stats.m_currentBytes -= (int64_t) size;
+        }
+
+        //-------------------------------------------------------------------------
+
+        static void UnlinkSlab( ThreadPool* pPool, Slab* pSlab )
+        {
+            if ( pSlab->m_pPrev != nullptr )
+            {
+                pSlab->m_pPrev->m_pNext = pSlab->m_pNext;
+            }
+            else
+            {
+                pPool->m_slabs[pSlab->m_classIdx] = pSlab->m_pNext;
+            }
+
+            if ( pSlab->m_pNext != nullptr )
+            {
+                pSlab->m_pNext->m_pPrev = pSlab->m_pPrev;
+            }
+
+            pSlab->m_pPrev = pSlab->m_pNext = nullptr;
+        }
+
+        static void PushSlabToFront( ThreadPool* pPool, Slab* pSlab )
+        {
+            Slab*& pHead = pPool->m_slabs[pSlab->m_classIdx];
+            pSlab->m_pPrev = nullptr;
+            pSlab->m_pNext = pHead;
+            if ( pHead != nullptr )
+            {
+                pHead->m_pPrev = pSlab;
+            }
+            pHead = pSlab;
+        }
+
+        static void MoveSlabToBack( ThreadPool* pPool, Slab* pSlab )
+        {
+            if ( pSlab->m_pNext == nullptr )
+            {
+                return;
+            }
+
+            Slab* pLast = pSlab->m_pNext;
+            while ( pLast->m_pNext != nullptr )
+            {
+                pLast = pLast->m_pNext;
+            }
+
+            UnlinkSlab( pPool, pSlab );
+            pLast->m_pNext = pSlab;
+            pSlab->m_pPrev = pLast;
+        }
+
+        static Slab* CreateSlab( ThreadPool* pPool, uint32_t classIdx )
+        {
+            uint32_t const blockSize = g_classSizes[classIdx] + (uint32_t) sizeof( BlockHeader );
+            size_t const slabSize = std::max( s_minSlabSize, s_slabHeaderSize + s_minBlocksPerSlab * blockSize );
+
+            auto pMemory = static_cast<uint8_t*>( g_pDefaultMalloc( slabSize ) );
+            if ( pMemory == nullptr )
+            {
+                return nullptr;
+            }
+
+            auto pSlab = reinterpret_cast<Slab*>( pMemory );
+            pSlab->m_pPool = pPool;
+            pSlab->m_pBump = pMemory + s_slabHeaderSize;
+            pSlab->m_pEnd = pMemory + slabSize;
+            pSlab->m_pFreeList = nullptr;
+            pSlab->m_classIdx = classIdx;
+            pSlab->m_blockSize = blockSize;
+            pSlab->m_numLiveBlocks = 0;
+            PushSlabToFront( pPool, pSlab );
+            return pSlab;
+        }
+
+        static void ReleaseBlockToSlab( ThreadPool* pPool, BlockHeader* pBlock )
+        {
+            Slab* pSlab = pBlock->m_pSlab;
+            assert( pSlab->m_pPool == pPool && pSlab->m_numLiveBlocks > 0 );
+
+            bool const wasFull = !pSlab->HasFreeBlock();
+            pBlock->m_pNextFree = pSlab->m_pFreeList;
+            pSlab->m_pFreeList = pBlock;
+            pSlab->m_numLiveBlocks--;
+
+            if ( wasFull )
+            {
+                UnlinkSlab( pPool, pSlab );
+                PushSlabToFront( pPool, pSlab );
+            }
+        }
+
+        static void CollectRemoteFrees( ThreadPool* pPool )
+        {
+            if ( pPool->m_remoteFrees.load( std::memory_order_relaxed ) == nullptr )
+            {
+                return;
+            }
+
+            BlockHeader* pBlock = pPool->m_remoteFrees.exchange( nullptr, std::memory_order_acquire );
+            while ( pBlock != nullptr )
+            {
+                BlockHeader* pNext = pBlock->m_pNextFree;
+                ReleaseBlockToSlab( pPool, pBlock );
+                pBlock = pNext;
+            }
+        }
+
+        static uint64_t ReleaseEmptySlabs( ThreadPool* pPool )
+        {
+            CollectRemoteFrees( pPool );
+
+            uint64_t numReleasedSlabs = 0;
+            for ( auto pSlab : pPool->m_slabs )
+            {
+                while ( pSlab != nullptr )
+                {
+                    Slab* pNext = pSlab->m_pNext;
+                    if ( pSlab->m_numLiveBlocks == 0 )
+                    {
+                        UnlinkSlab( pPool, pSlab );
+                        g_pDefaultFree( pSlab );
+                        numReleasedSlabs++;
+                    }
+                    pSlab = pNext;
+                }
+            }
+
+            return numReleasedSlabs;
+        }
+
+        //-------------------------------------------------------------------------
+
+        struct ThreadPoolReleaser
+        {
+            ~ThreadPoolReleaser()
+            {
+                t_isThreadExiting = true;
+                if ( t_pPool != nullptr )
+                {
+                    std::lock_guard<std::mutex> lock( g_poolMutex );
+                    t_pPool->m_pNextUnused = g_pUnusedPools;
+                    g_pUnusedPools = t_pPool;
+                    t_pPool = nullptr;
+                }
+            }
+        };
+
+        static thread_local ThreadPoolReleaser t_poolReleaser;
+
+        static ThreadPool* GetThreadPool()
+        {
+            if ( t_pPool != nullptr || t_isThreadExiting )
+            {
+                return t_pPool;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock( g_poolMutex );
+                if ( g_pUnusedPools != nullptr )
+                {
+                    t_pPool = g_pUnusedPools;
+                    g_pUnusedPools = t_pPool->m_pNextUnused;
+                    t_pPool->m_pNextUnused = nullptr;
+                }
+            }
+
+            if ( t_pPool == nullptr )
+            {
+                // Pools are not allocated through the handlers, and are never freed
+                t_pPool = new ThreadPool();
+            }
+
+            // Touch the releaser so that it gets constructed, and destroyed when this thread exits
+            (void) &t_poolReleaser;
+            return t_pPool;
+        }
+
+        //-------------------------------------------------------------------------
+
+        static void* AllocateDefault( size_t size )
+        {
+            if ( size > SIZE_MAX - sizeof( BlockHeader ) )
+            {
+                return nullptr;
+            }
+
+            auto pBlock = static_cast<BlockHeader*>( g_pDefaultMalloc( size + sizeof( BlockHeader ) ) );
+            if ( pBlock == nullptr )
+            {
+                return nullptr;
+            }
+
+            pBlock->m_pSlab = nullptr;
+            pBlock->m_size = size;
+            RecordAllocation( size );
+            return pBlock + 1;
+        }
+
+        static void* AllocatePooled( size_t size )
+        {
+            ThreadPool* pPool = GetThreadPool();
+            if ( pPool == nullptr )
+            {
+                return AllocateDefault( size );
+            }
+
+            CollectRemoteFrees( pPool );
+
+            uint32_t const classIdx = g_sizeToClass[( std::max( size, size_t( 1 ) ) + 15 ) >> 4];
+            Slab* pSlab = pPool->m_slabs[classIdx];
+            if ( pSlab == nullptr || !pSlab->HasFreeBlock() )
+            {
+                pSlab = CreateSlab( pPool, classIdx );
+                if ( pSlab == nullptr )
+                {
+                    return nullptr;
+                }
+            }
+
+            BlockHeader* pBlock = pSlab->m_pFreeList;
+            if ( pBlock != nullptr )
+            {
+                pSlab->m_pFreeList = pBlock->m_pNextFree;
+            }
+            else
+            {
+                pBlock = reinterpret_cast<BlockHeader*>( pSlab->m_pBump );
+                pSlab->m_pBump += pSlab->m_blockSize;
+            }
+
+            pBlock->m_pSlab = pSlab;
+            pSlab->m_numLiveBlocks++;
+
+            if ( !pSlab->HasFreeBlock() )
+            {
+                MoveSlabToBack( pPool, pSlab );
+            }
+
+            RecordAllocation( g_classSizes[classIdx] );
+            return pBlock + 1;
+        }
+
+        static inline size_t GetUsableSize( BlockHeader const* pBlock )
+        {
+            return ( pBlock->m_pSlab != nullptr ) ? g_classSizes[pBlock->m_pSlab->m_classIdx] : (size_t) pBlock->m_size;
+        }
+
+        //-------------------------------------------------------------------------
+
+        static void* Malloc( size_t size )
+        {
+            if ( g_mode == Mode::Pool && size <= s_maxPooledSize )
+            {
+                return AllocatePooled( size );
+            }
+
+            return AllocateDefault( size );
+        }
+
+        static void Free( void* pMemory )
+        {
+            if ( pMemory == nullptr )
+            {
+                return;
+            }
+
+            BlockHeader* pBlock = static_cast<BlockHeader*>( pMemory ) - 1;
+            RecordFree( GetUsableSize( pBlock ) );
+
+            Slab* pSlab = pBlock->m_pSlab;
+            if ( pSlab == nullptr )
+            {
+                g_pDefaultFree( pBlock );
+                return;
+            }
+
+            ThreadPool* pOwner = pSlab->m_pPool;
+            if ( pOwner == t_pPool )
+            {
+                ReleaseBlockToSlab( pOwner, pBlock );
+                return;
+            }
+
+            BlockHeader* pHead = pOwner->m_remoteFrees.load( std::memory_order_relaxed );
+            do
+            {
+                pBlock->m_pNextFree = pHead;
+            }
+            while ( !pOwner->m_remoteFrees.compare_exchange_weak( pHead, pBlock, std::memory_order_release, std::memory_order_relaxed ) );
+        }
+
+        static void* Calloc( size_t count, size_t size )
+        {
+            if ( size != 0 && count > SIZE_MAX / size )
+            {
+                return nullptr;
+            }
+
+            void* pMemory = Malloc( count * size );
+            if ( pMemory != nullptr )
+            {
+                memset( pMemory, 0, count * size );
+            }
+
+            return pMemory;
+        }
+
+        static void* Realloc( void* pMemory, size_t size )
+        {
+            if ( pMemory == nullptr )
+            {
+                return Malloc( size );
+            }
+
+            if ( size == 0 )
+            {
+                Free( pMemory );
+                return nullptr;
+            }
+
+            BlockHeader* pBlock = static_cast<BlockHeader*>( pMemory ) - 1;
+            size_t const usableSize = GetUsableSize( pBlock );
+
+            // Large blocks stay large, so we let the default handler grow them in place when it can
+            if ( pBlock->m_pSlab == nullptr && ( g_mode == Mode::Count || size > s_maxPooledSize ) )
+            {
+                if ( size > SIZE_MAX - sizeof( BlockHeader ) )
+                {
+                    return nullptr;
+                }
+
+                auto pNewBlock = static_cast<BlockHeader*>( g_pDefaultRealloc( pBlock, size + sizeof( BlockHeader ) ) );
+                if ( pNewBlock == nullptr )
+                {
+                    return nullptr;
+                }
+
+                pNewBlock->m_size = size;
+                RecordFree( usableSize );
+                RecordAllocation( size );
+                return pNewBlock + 1;
+            }
+
+            if ( size <= usableSize && pBlock->m_pSlab != nullptr )
+            {
+                return pMemory;
+            }
+
+            void* pNewMemory = Malloc( size );
+            if ( pNewMemory != nullptr )
+            {
+                memcpy( pNewMemory, pMemory, std::min( size, usableSize ) );
+                Free( pMemory );
+            }
+
+            return pNewMemory;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+
+    bool ParseMode( std::string const& modeString, Mode& outMode )
+    {
+        if ( _stricmp( modeString.c_str(), "count" ) == 0 )
+        {
+            outMode = Mode::Count;
+            return true;
+        }
+
+        if ( _stricmp( modeString.c_str(), "pool" ) == 0 )
+        {
+            outMode = Mode::Pool;
+            return true;
+        }
+
+        return false;
+    }
+
+    void Install( Mode mode )
+    {
+        assert( g_mode == Mode::Default );
+        if ( mode == Mode::Default )
+        {
+            return;
+        }
+
+        InitializeSizeClasses();
+        g_pDefaultMalloc = FbxGetDefaultMallocHandler();
+        g_pDefaultRealloc = FbxGetDefaultReallocHandler();
+        g_pDefaultFree = FbxGetDefaultFreeHandler();
+        g_mode = mode;
+
+        FbxSetMallocHandler( Malloc );
+        FbxSetCallocHandler( Calloc );
+        FbxSetReallocHandler( Realloc );
+        FbxSetFreeHandler( Free );
+    }
+
+    bool IsInstalled()
+    {
+        return g_mode != Mode::Default;
+    }
+
+    //-------------------------------------------------------------------------
+
+    void BeginFile()
+    {
+        t_stats = {};
+    }
+
+    FileStats EndFile()
+    {
+        FileStats stats;
+        stats.m_numAllocations = t_stats.m_numAllocations;
+        stats.m_peakBytes = (uint64_t) std::max( t_stats.m_peakBytes, int64_t( 0 ) );
+
+        // The SDK manager and its caches outlive the file, so the pools can't simply be reset. Instead we give back the slabs the file emptied.
+        if ( g_mode == Mode::Pool && t_pPool != nullptr )
+        {
+            stats.m_numReleasedSlabs = ReleaseEmptySlabs( t_pPool );
+        }
+
+        t_stats = {};
+        return stats;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+//-------------------------------------------------------------------------
+// Optional allocation handlers for the FBX SDK, installed through FbxSetMallocHandler and friends.
+// In pool mode, small allocations come from per-thread size class pools rather than the general purpose heap. Each converter runs on its own
+// thread, so a conversion mostly allocates and frees from its own pools without any locking. Both modes count the allocations and peak bytes
+// of each file, and the empty pool slabs are released at the end of each file.
+//-------------------------------------------------------------------------
+
+namespace SdkAllocator
+{
+    enum class Mode
+    {
+        Default,    // The SDK's own allocator, nothing is installed
+        Count,      // The SDK's own allocator with per file statistics
+        Pool,       // Size class pools with per file statistics
+    };
+
+    // Valid modes are "count" and "pool"
+    bool ParseMode( std::string const& modeString, Mode& outMode );
+
+    // This needs to be called before the SDK allocates anything (i.e. before any manager is created), and can only be called once
+    void Install( Mode mode );
+
+    bool IsInstalled();
+
+    //-------------------------------------------------------------------------
+
+    struct FileStats
+    {
+        uint64_t                    m_numAllocations = 0;
+        uint64_t                    m_peakBytes = 0;
+        uint64_t                    m_numReleasedSlabs = 0;
+    };
+
+    // Starts recording the allocations made on the calling thread
+    void BeginFile();
+
+    // Returns the statistics recorded on the calling thread since BeginFile, and releases the empty pool slabs of this thread
+    FileStats EndFile();
+}
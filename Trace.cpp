@@ -0,0 +1,239 @@
+#include "Trace.h"
+#include <windows.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//-------------------------------------------------------------------------
+// Each thread appends its spans to its own buffer, which is registered on the thread's first span. A buffer is written to the file whenever it
+// fills up and when its thread exits, so long runs (i.e. -watch, which starts new workers for every batch) only ever hold a few events per thread.
+//-------------------------------------------------------------------------
+
+namespace Trace
+{
+    namespace
+    {
+        struct Event
+        {
+            char const*                 m_pName;
+            std::string                 m_filePath;
+            double                      m_startTime;            // Microseconds since the trace started
+            double                      m_duration;
+        };
+
+        struct ThreadBuffer
+        {
+            uint32_t                    m_threadID = 0;
+            std::string                 m_threadName;
+            std::vector<Event>          m_events;
+            bool                        m_isThreadNameWritten = false;
+        };
+
+        // Writes the remaining events of the thread and releases its buffer when the thread exits
+        struct ThreadBufferOwner
+        {
+            ~ThreadBufferOwner();
+
+            ThreadBuffer*               m_pBuffer = nullptr;
+        };
+
+        static size_t const g_maxBufferedEvents = 4096;
+
+        static std::atomic<bool> g_isEnabled( false );
+        static FILE* g_pTraceFile = nullptr;
+        static std::chrono::steady_clock::time_point g_startTime;
+
+        // Guards the buffer list and the trace file, which is written by whichever thread flushes its buffer
+        static std::mutex g_threadBuffersMutex;
+        static std::vector<std::unique_ptr<ThreadBuffer>> g_threadBuffers;
+        static uint32_t g_nextThreadID = 1;
+        static bool g_isFirstEvent = true;
+
+        static thread_local ThreadBufferOwner t_threadBuffer;
+
+        //-------------------------------------------------------------------------
+
+        static double GetTraceTime()
+        {
+            return std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - g_startTime ).count();
+        }
+
+        static ThreadBuffer& GetThreadBuffer()
+        {
+            if ( t_threadBuffer.m_pBuffer == nullptr )
+            {
+                std::lock_guard<std::mutex> lock( g_threadBuffersMutex );
+                g_threadBuffers.emplace_back( new ThreadBuffer() );
+                t_threadBuffer.m_pBuffer = g_threadBuffers.back().get();
+                t_threadBuffer.m_pBuffer->m_threadID = g_nextThreadID++;
+            }
+
+            return *t_threadBuffer.m_pBuffer;
+        }
+
+        // File paths are the only strings that can contain characters that need escaping (i.e. backslashes)
+        static void WriteJsonString( FILE* pFile, char const* pString )
+        {
+            fputc( '"', pFile );
+            for ( char const* pChar = pString; *pChar != 0; pChar++ )
+            {
+                unsigned char const c = (unsigned char) *pChar;
+                if ( c == '"' || c == '\\' )
+                {
+                    fputc( '\\', pFile );
+                    fputc( c, pFile );
+                }
+                else if ( c < 0x20 )
+                {
+                    fprintf( pFile, "\\u%04x", c );
+                }
+                else
+                {
+                    fputc( c, pFile );
+                }
+            }
+            fputc( '"', pFile );
+        }
+
+        // Writes the buffered events and clears the buffer, the caller needs to hold the buffer mutex
+        static void WriteThreadBuffer( ThreadBuffer& threadBuffer )
+        {
+            if ( g_pTraceFile == nullptr )
+            {
+                threadBuffer.m_events.clear();
+                return;
+            }
+
+            uint32_t const processID = (uint32_t) GetCurrentProcessId();
+            if ( !threadBuffer.m_threadName.empty() && !threadBuffer.m_isThreadNameWritten )
+            {
+                fprintf( g_pTraceFile, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":", g_isFirstEvent ? "" : ",", processID, threadBuffer.m_threadID );
+                WriteJsonString( g_pTraceFile, threadBuffer.m_threadName.c_str() );
+                fprintf( g_pTraceFile, "}}" );
+                threadBuffer.m_isThreadNameWritten = true;
+                g_isFirstEvent = false;
+            }
+
+            for ( Event const& event : threadBuffer.m_events )
+            {
+                fprintf( g_pTraceFile, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", g_isFirstEvent ? "" : ",", event.m_pName, processID, threadBuffer.m_threadID, event.m_startTime, event.m_duration );
+                if ( !event.m_filePath.empty() )
+                {
+                    fprintf( g_pTraceFile, ",\"args\":{\"file\":" );
+                    WriteJsonString( g_pTraceFile, event.m_filePath.c_str() );
+                    fprintf( g_pTraceFile, "}" );
+                }
+                fprintf( g_pTraceFile, "}" );
+                g_isFirstEvent = false;
+            }
+
+            threadBuffer.m_events.clear();
+        }
+
+        ThreadBufferOwner::~ThreadBufferOwner()
+        {
+            if ( m_pBuffer == nullptr )
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock( g_threadBuffersMutex );
+            WriteThreadBuffer( *m_pBuffer );
+
+            auto const iter = std::find_if( g_threadBuffers.begin(), g_threadBuffers.end(), [this] ( std::unique_ptr<ThreadBuffer> const& pThreadBuffer ) { return pThreadBuffer.get() == m_pBuffer; } );
+            assert( iter != g_threadBuffers.end() );
+            g_threadBuffers.erase( iter );
+            m_pBuffer = nullptr;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+
+    bool Begin( std::string const& traceFilePath, std::string& errorMessage )
+    {
+        assert( !g_isEnabled && g_pTraceFile == nullptr );
+
+        if ( fopen_s( &g_pTraceFile, traceFilePath.c_str(), "w" ) != 0 )
+        {
+            errorMessage = "failed to create trace file";
+            g_pTraceFile = nullptr;
+            return false;
+        }
+
+        fprintf( g_pTraceFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+        g_isFirstEvent = true;
+
+        g_startTime = std::chrono::steady_clock::now();
+        g_isEnabled = true;
+        return true;
+    }
+
+    void End()
+    {
+        if ( !g_isEnabled )
+        {
+            return;
+        }
+
+        g_isEnabled = false;
+
+        // The traced threads are done, so every remaining buffer can be written from here
+        std::lock_guard<std::mutex> lock( g_threadBuffersMutex );
+        for ( auto const& pThreadBuffer : g_threadBuffers )
+        {
+            WriteThreadBuffer( *pThreadBuffer );
+        }
+        fprintf( g_pTraceFile, "\n]}\n" );
+
+        fclose( g_pTraceFile );
+        g_pTraceFile = nullptr;
+    }
+
+    bool IsEnabled()
+    {
+        return g_isEnabled;
+    }
+
+    void SetThreadName( std::string const& threadName )
+    {
+        if ( g_isEnabled )
+        {
+            GetThreadBuffer().m_threadName = threadName;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+
+    ScopedSpan::ScopedSpan( char const* pName, std::string const& filePath )
+    {
+        assert( pName != nullptr );
+        if ( g_isEnabled )
+        {
+            m_pName = pName;
+            m_filePath = filePath;
+            m_startTime = GetTraceTime();
+        }
+    }
+
+    ScopedSpan::~ScopedSpan()
+    {
+        if ( m_pName != nullptr && g_isEnabled )
+        {
+            double const endTime = GetTraceTime();
+            ThreadBuffer& threadBuffer = GetThreadBuffer();
+            threadBuffer.m_events.push_back( { m_pName, std::move( m_filePath ), m_startTime, endTime - m_startTime } );
+
+            if ( threadBuffer.m_events.size() >= g_maxBufferedEvents )
+            {
+                std::lock_guard<std::mutex> lock( g_threadBuffersMutex );
+                WriteThreadBuffer( threadBuffer );
+            }
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+
+//-------------------------------------------------------------------------
+// Optional timeline of a run in the Chrome trace event format, which can be opened in Perfetto (ui.perfetto.dev) or chrome://tracing.
+// Spans are recorded into per thread buffers without contention and are tagged with the file they belong to, so stalls and contention between batch
+// workers show up as gaps and "WaitForWork" spans on the worker tracks. Nothing is recorded unless a trace was started.
+//-------------------------------------------------------------------------
+
+namespace Trace
+{
+    // Creates the trace file and starts recording. Each thread's events are written once it has buffered a few thousand of them and when the
+    // thread exits, the rest once the trace ends. This can only be called once.
+    bool Begin( std::string const& traceFilePath, std::string& errorMessage );
+
+    // Writes the remaining events and closes the trace file. All the traced threads need to be done (i.e. joined) by then.
+    void End();
+
+    bool IsEnabled();
+
+    // Names the calling thread's track in the trace
+    void SetThreadName( std::string const& threadName );
+
+    //-------------------------------------------------------------------------
+
+    // Records a span from construction to destruction. The name needs to be a string literal, the file path is copied.
+    class ScopedSpan
+    {
+    public:
+
+        ScopedSpan( char const* pName, std::string const& filePath = std::string() );
+        ~ScopedSpan();
+
+    private:
+
+        ScopedSpan( ScopedSpan const& ) = delete;
+        ScopedSpan& operator=( ScopedSpan const& ) = delete;
+
+    private:
+
+        char const*                 m_pName = nullptr;          // Null when not recording
+        std::string                 m_filePath;
+        double                      m_startTime = 0;
+    };
+
+    // Ends the trace when going out of scope, so that the trace is written on every exit path
+    class ScopedSession
+    {
+    public:
+
+        ScopedSession() = default;
+        ~ScopedSession() { End(); }
+
+    private:
+
+        ScopedSession( ScopedSession const& ) = delete;
+        ScopedSession& operator=( ScopedSession const& ) = delete;
+    };
+}
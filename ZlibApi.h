@@ -0,0 +1,75 @@
+#pragma once
+
+//-------------------------------------------------------------------------
+// The FBX SDK ships with a static zlib build (zlib-mt.lib) which we already link against, but it doesn't ship the zlib headers.
+// This declares the small subset of the zlib API that we use, the stream layout matches zlib 1.2.x.
+//-------------------------------------------------------------------------
+
+extern "C"
+{
+    struct z_stream_s
+    {
+        unsigned char const*    next_in;
+        unsigned int            avail_in;
+        unsigned long           total_in;
+
+        unsigned char*          next_out;
+        unsigned int            avail_out;
+        unsigned long           total_out;
+
+        char const*             msg;
+        struct internal_state*  state;
+
+        void*                   ( *zalloc )( void*, unsigned int, unsigned int );
+        void                    ( *zfree )( void*, void* );
+        void*                   opaque;
+
+        int                     data_type;
+        unsigned long           adler;
+        unsigned long           reserved;
+    };
+
+    typedef struct z_stream_s z_stream;
+
+    char const* zlibVersion( void );
+    int uncompress( unsigned char* pDest, unsigned long* pDestLen, unsigned char const* pSource, unsigned long sourceLen );
+
+    int deflateInit2_( z_stream* pStream, int level, int method, int windowBits, int memLevel, int strategy, char const* pVersion, int streamSize );
+    int deflate( z_stream* pStream, int flush );
+    int deflateEnd( z_stream* pStream );
+    unsigned long deflateBound( z_stream* pStream, unsigned long sourceLen );
+
+    int inflateInit2_( z_stream* pStream, int windowBits, char const* pVersion, int streamSize );
+    int inflate( z_stream* pStream, int flush );
+    int inflateReset( z_stream* pStream );
+    int inflateEnd( z_stream* pStream );
+}
+
+namespace Zlib
+{
+    static int const s_resultOK = 0;
+    static int const s_resultStreamEnd = 1;
+    static int const s_resultBufferError = -5;
+
+    static int const s_flushNone = 0;
+    static int const s_flushFinish = 4;
+
+    static int const s_defaultCompression = -1;
+    static int const s_deflated = 8;
+    static int const s_defaultStrategy = 0;
+    static int const s_defaultMemLevel = 8;
+
+    // Adding 16 to the window bits selects the gzip format, adding 32 auto detects zlib/gzip when decompressing
+    static int const s_gzipWindowBits = 15 + 16;
+    static int const s_autoDetectWindowBits = 15 + 32;
+
+    inline int DeflateInit2( z_stream* pStream, int level, int windowBits )
+    {
+        return deflateInit2_( pStream, level, s_deflated, windowBits, s_defaultMemLevel, s_defaultStrategy, zlibVersion(), (int) sizeof( z_stream ) );
+    }
+
+    inline int InflateInit2( z_stream* pStream, int windowBits )
+    {
+        return inflateInit2_( pStream, windowBits, zlibVersion(), (int) sizeof( z_stream ) );
+    }
+}
@@ -6,6 +6,13 @@
 #include <assert.h>
 #include <functional>
 #include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <atomic>
+#include <map>
+#include <set>
 
 #if _MSC_VER
 #pragma warning(push, 0)
@@ -19,6 +26,17 @@
 #pragma warning(pop)
 #endif
 
+#include "Compression.h"
+#include "FbxRawReader.h"
+#include "FbxVerify.h"
+#include "SceneFilter.h"
+#include "SceneSplitter.h"
+#include "EmbeddedMedia.h"
+#include "FolderWatcher.h"
+#include "SdkAllocator.h"
+#include "MeshProcessing.h"
+#include "Trace.h"
+
 //-------------------------------------------------------------------------
 
 enum class FileFormat
@@ -79,31 +97,68 @@ namespace FileSystemHelpers
         return false;
     }
 
-    static FileFormat GetFileFormat( std::string const& filePath )
+    static bool IsValidFilePath( std::string const& filePath )
     {
-        FileFormat fileFormat = FileFormat::Unknown;
+        DWORD const result = GetFileAttributesA( filePath.c_str() );
+        return result != INVALID_FILE_ATTRIBUTES && !( result & FILE_ATTRIBUTE_DIRECTORY );
+    }
+
+    static uint64_t GetFileSizeInBytes( std::string const& filePath )
+    {
+        WIN32_FILE_ATTRIBUTE_DATA fileData;
+        if ( !GetFileAttributesExA( filePath.c_str(), GetFileExInfoStandard, &fileData ) )
+        {
+            return 0;
+        }
+
+        return ( uint64_t( fileData.nFileSizeHigh ) << 32 ) | uint64_t( fileData.nFileSizeLow );
+    }
+
+    // Reads the start of the file, compressed files are transparently decompressed. Returns the number of bytes read.
+    static size_t ReadFileHeader( std::string const& filePath, char* pHeader, size_t headerCapacity )
+    {
+        if ( Compression::IsCompressedFile( filePath ) )
+        {
+            std::vector<char> decompressedHeader;
+            std::string errorMessage;
+            if ( !Compression::DecompressFileToMemory( filePath, decompressedHeader, errorMessage, headerCapacity ) && decompressedHeader.empty() )
+            {
+                return 0;
+            }
+
+            memcpy( pHeader, decompressedHeader.data(), decompressedHeader.size() );
+            return decompressedHeader.size();
+        }
 
         FILE* fp = nullptr;
-        int errcode = fopen_s( &fp, filePath.c_str(), "r" );
+        int errcode = fopen_s( &fp, filePath.c_str(), "rb" );
         if ( errcode != 0 )
         {
-            return fileFormat;
+            return 0;
         }
 
-        //-------------------------------------------------------------------------
+        size_t const readLength = fread( pHeader, 1, headerCapacity, fp );
+        fclose( fp );
+        return readLength;
+    }
 
-        fseek( fp, 0, SEEK_END );
-        size_t filesize = (size_t) ftell( fp );
-        fseek( fp, 0, SEEK_SET );
+    static FileFormat GetFileFormat( std::string const& filePath )
+    {
+        Trace::ScopedSpan span( "GetFileFormat", filePath );
+        FileFormat fileFormat = FileFormat::Unknown;
 
-        void* pFileData = malloc( filesize );
-        size_t readLength = fread( pFileData, 1, filesize, fp );
-        fclose( fp );
+        // Binary files always start with a null terminated magic string, so we only need to check the header rather than reading the whole file
+        char fileHeader[1024];
+        size_t const readLength = ReadFileHeader( filePath, fileHeader, sizeof( fileHeader ) );
+        if ( readLength == 0 )
+        {
+            return fileFormat;
+        }
 
         //-------------------------------------------------------------------------
 
         // Ascii files cannot contain the null character
-        if ( memchr( pFileData, '\0', readLength ) != NULL )
+        if ( memchr( fileHeader, '\0', readLength ) != NULL )
         {
             fileFormat = FileFormat::Binary;
         }
@@ -115,6 +170,34 @@ namespace FileSystemHelpers
         return fileFormat;
     }
 
+    // The SDK can't probe compressed files, so we check the decompressed header the same way the native reader does
+    static bool IsCompressedFbxFile( std::string const& filePath )
+    {
+        char fileHeader[1024];
+        size_t const readLength = ReadFileHeader( filePath, fileHeader, sizeof( fileHeader ) );
+        return FbxRaw::HasBinaryHeader( fileHeader, readLength ) || FbxRaw::HasAsciiHeader( fileHeader, readLength );
+    }
+
+    static std::string GetTemporaryFilePath( char const* pExtension )
+    {
+        static std::atomic<uint32_t> s_temporaryFileCounter( 0 );
+
+        char tempDirectoryPath[MAX_PATH] = { 0 };
+        GetTempPathA( MAX_PATH, tempDirectoryPath );
+
+        char stringBuffer[1024] = { 0 };
+        sprintf_s( stringBuffer, 1024, "%sFbxFormatConverter_%u_%u%s", tempDirectoryPath, (uint32_t) GetCurrentProcessId(), (uint32_t) s_temporaryFileCounter++, pExtension );
+        return std::string( stringBuffer );
+    }
+
+    static void DeleteTemporaryFile( bool isTemporaryFile, std::string const& filePath )
+    {
+        if ( isTemporaryFile )
+        {
+            DeleteFileA( filePath.c_str() );
+        }
+    }
+
     static void GetDirectoryContents( std::string const& directoryPath, std::vector<std::string>& directoryContents )
     {
         if ( !IsValidDirectoryPath( directoryPath ) )
@@ -123,6 +206,8 @@ namespace FileSystemHelpers
             return;
         }
 
+        Trace::ScopedSpan span( "GetDirectoryContents", directoryPath );
+
         //-------------------------------------------------------------------------
 
         std::string const directorySearchPath = directoryPath + "*";
@@ -160,8 +245,65 @@ namespace FileSystemHelpers
     static bool MakeDir( char const* pDirectoryPath )
     {
         assert( pDirectoryPath != nullptr );
+        Trace::ScopedSpan span( "MakeDir", pDirectoryPath );
         return SUCCEEDED( SHCreateDirectoryExA( nullptr, pDirectoryPath, nullptr ) );
     }
+
+    // File times are in 100ns intervals
+    static uint64_t GetCurrentFileTime()
+    {
+        FILETIME fileTime;
+        GetSystemTimeAsFileTime( &fileTime );
+        return ( uint64_t( fileTime.dwHighDateTime ) << 32 ) | uint64_t( fileTime.dwLowDateTime );
+    }
+
+    static uint64_t GetFileLastWriteTime( std::string const& filePath )
+    {
+        WIN32_FILE_ATTRIBUTE_DATA fileData;
+        if ( !GetFileAttributesExA( filePath.c_str(), GetFileExInfoStandard, &fileData ) )
+        {
+            return 0;
+        }
+
+        return ( uint64_t( fileData.ftLastWriteTime.dwHighDateTime ) << 32 ) | uint64_t( fileData.ftLastWriteTime.dwLowDateTime );
+    }
+
+    // Returns true if some other process still has the file open for writing (i.e. it's still being written)
+    static bool IsFileInUse( std::string const& filePath )
+    {
+        HANDLE fileHandle = CreateFileA( filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+        if ( fileHandle == INVALID_HANDLE_VALUE )
+        {
+            return GetLastError() == ERROR_SHARING_VIOLATION;
+        }
+
+        CloseHandle( fileHandle );
+        return false;
+    }
+}
+
+//-------------------------------------------------------------------------
+
+struct ConversionSettings
+{
+    FileFormat              m_outputFormat = FileFormat::Binary;
+    bool                    m_compressOutput = false;
+    int                     m_numCompressionThreads = 1;
+    SceneFilter             m_filter;
+    SceneSplitter::SplitMode    m_splitMode = SceneSplitter::SplitMode::None;
+    EmbeddedMedia::Mode         m_mediaMode = EmbeddedMedia::Mode::Stream;
+    MeshProcessing::Settings    m_meshProcessing;
+};
+
+//-------------------------------------------------------------------------
+
+// Only prints anything when one of the -alloc modes is installed
+static void PrintAllocationStats( std::string const& filePath, SdkAllocator::FileStats const& stats )
+{
+    if ( SdkAllocator::IsInstalled() )
+    {
+        printf( "Allocations: %s\nCount: %llu, Peak: %.2f MB, Released slabs: %llu\n\n", filePath.c_str(), (unsigned long long) stats.m_numAllocations, stats.m_peakBytes / ( 1024.0 * 1024.0 ), (unsigned long long) stats.m_numReleasedSlabs );
+    }
 }
 
 //-------------------------------------------------------------------------
@@ -174,6 +316,7 @@ public:
         : m_pManager( FbxManager::Create() )
     {
         assert( m_pManager != nullptr );
+        m_pManager->SetIOSettings( FbxIOSettings::Create( m_pManager, IOSROOT ) );
         auto pIOPluginRegistry = m_pManager->GetIOPluginRegistry();
 
         // Find the IDs for the ascii and binary writers
@@ -206,69 +349,291 @@ public:
         m_pManager = nullptr;
     }
 
-    int ConvertFbxFile( std::string const& inputFilepath, std::string const& outputFilepath, FileFormat outputFormat )
+    int ConvertFbxFile( std::string const& inputFilepath, std::string const& outputFilepath, ConversionSettings const& settings )
+    {
+        Trace::ScopedSpan span( "ConvertFbxFile", inputFilepath );
+        SdkAllocator::BeginFile();
+
+        bool exportSucceeded = false;
+        FbxScene* pScene = ImportScene( inputFilepath, settings );
+        if ( pScene != nullptr )
+        {
+            exportSucceeded = ExportScene( pScene, inputFilepath, outputFilepath, settings );
+            DestroyScene( pScene );
+        }
+
+        PrintAllocationStats( inputFilepath, SdkAllocator::EndFile() );
+        return exportSucceeded ? 0 : 1;
+    }
+
+    // The scene is owned by the manager, so we need to explicitly release it otherwise it stays alive until the converter is destroyed
+    void DestroyScene( FbxScene* pScene )
+    {
+        assert( pScene != nullptr );
+        pScene->Destroy();
+        ReleaseImportedMedia();
+    }
+
+    // Imports, filters and processes the scene, returns null on failure. The scene is owned by the caller and needs to be released with DestroyScene.
+    FbxScene* ImportScene( std::string const& inputFilepath, ConversionSettings const& settings )
     {
+        // Compressed inputs are decompressed to a temporary file since the SDK can only import from uncompressed files
+        //-------------------------------------------------------------------------
+
+        std::string importFilepath = inputFilepath;
+        bool const isCompressedInput = Compression::IsCompressedFile( inputFilepath );
+        if ( isCompressedInput )
+        {
+            importFilepath = FileSystemHelpers::GetTemporaryFilePath( ".fbx" );
+
+            std::string errorMessage;
+            if ( !Compression::DecompressFile( inputFilepath, importFilepath, errorMessage ) )
+            {
+                printf( "Error! Failed to decompress FBX file ( %s ): %s\n\n", inputFilepath.c_str(), errorMessage.c_str() );
+                return nullptr;
+            }
+        }
+
+        // Embedded media is stripped before import so the SDK never loads it, it gets streamed back in on export (see EmbeddedMedia).
+        // The source file needs to stay around until the scene is destroyed, if the file can't be scanned we just leave it to the SDK.
+        //-------------------------------------------------------------------------
+
+        m_importedMedia.m_filePath = importFilepath;
+        m_importedMedia.m_isTemporaryFile = isCompressedInput;
+
+        std::string scanErrorMessage;
+        if ( !EmbeddedMedia::FindMedia( importFilepath, m_importedMedia.m_blobs, scanErrorMessage ) )
+        {
+            m_importedMedia.m_blobs.clear();
+        }
+
+        std::string sdkImportFilepath = importFilepath;
+        if ( m_importedMedia.HasMedia() )
+        {
+            sdkImportFilepath = FileSystemHelpers::GetTemporaryFilePath( ".fbx" );
+
+            std::string errorMessage;
+            if ( !EmbeddedMedia::WriteFileWithoutMedia( m_importedMedia, sdkImportFilepath, errorMessage ) )
+            {
+                printf( "Error! Failed to strip embedded media from FBX file ( %s ): %s\n\n", inputFilepath.c_str(), errorMessage.c_str() );
+                FileSystemHelpers::DeleteTemporaryFile( true, sdkImportFilepath );
+                ReleaseImportedMedia();
+                return nullptr;
+            }
+        }
+
         // Import
         //-------------------------------------------------------------------------
 
+        settings.m_filter.ApplyImportSettings( m_pManager->GetIOSettings() );
+
         FbxImporter* pImporter = FbxImporter::Create( m_pManager, "FBX Importer" );
-        if ( !pImporter->Initialize( inputFilepath.c_str(), -1, m_pManager->GetIOSettings() ) )
+        bool isImporterInitialized = false;
+        {
+            Trace::ScopedSpan span( "FbxImporter::Initialize", inputFilepath );
+            isImporterInitialized = pImporter->Initialize( sdkImportFilepath.c_str(), -1, m_pManager->GetIOSettings() );
+        }
+
+        if ( !isImporterInitialized )
         {
             printf( "Error! Failed to load specified FBX file ( %s ): %s\n\n", inputFilepath.c_str(), pImporter->GetStatus().GetErrorString() );
-            return 1;
+            pImporter->Destroy();
+            FileSystemHelpers::DeleteTemporaryFile( m_importedMedia.HasMedia(), sdkImportFilepath );
+            ReleaseImportedMedia();
+            return nullptr;
         }
 
+        settings.m_filter.SelectAnimStacks( pImporter );
+
         auto pScene = FbxScene::Create( m_pManager, "ImportScene" );
-        if ( !pImporter->Import( pScene ) )
+        bool isSceneImported = false;
+        {
+            Trace::ScopedSpan span( "FbxImporter::Import", inputFilepath );
+            isSceneImported = pImporter->Import( pScene );
+        }
+
+        if ( !isSceneImported )
         {
             printf( "Error! Failed to import scene from file ( %s ): %s\n\n", inputFilepath.c_str(), pImporter->GetStatus().GetErrorString() );
             pImporter->Destroy();
-            return 1;
+            pScene->Destroy();
+            FileSystemHelpers::DeleteTemporaryFile( m_importedMedia.HasMedia(), sdkImportFilepath );
+            ReleaseImportedMedia();
+            return nullptr;
         }
         pImporter->Destroy();
 
+        // Only keep the source file around if we'll need to stream media from it
+        if ( m_importedMedia.HasMedia() )
+        {
+            FileSystemHelpers::DeleteTemporaryFile( true, sdkImportFilepath );
+        }
+        else
+        {
+            ReleaseImportedMedia();
+        }
+
+        settings.m_filter.PruneScene( pScene );
+
+        if ( settings.m_meshProcessing.IsActive() )
+        {
+            MeshProcessing::Results results;
+            MeshProcessing::ProcessScene( pScene, settings.m_meshProcessing, results );
+
+            if ( results.m_numFailedTriangulations > 0 )
+            {
+                printf( "Warning! Failed to triangulate %d meshes ( %s )\n\n", results.m_numFailedTriangulations, inputFilepath.c_str() );
+            }
+
+            if ( results.m_numMeshesWithoutUVs > 0 )
+            {
+                printf( "Warning! No tangents generated for %d meshes without UVs ( %s )\n\n", results.m_numMeshesWithoutUVs, inputFilepath.c_str() );
+            }
+
+            if ( results.m_numInvalidMeshes > 0 )
+            {
+                printf( "Warning! No tangents generated for %d meshes with an unsupported UV mapping or invalid indices ( %s )\n\n", results.m_numInvalidMeshes, inputFilepath.c_str() );
+            }
+        }
+
+        return pScene;
+    }
+
+    // Exports the scene in the requested format, the scene is left untouched
+    bool ExportScene( FbxScene* pScene, std::string const& inputFilepath, std::string const& outputFilepath, ConversionSettings const& settings )
+    {
+        assert( pScene != nullptr );
+
         // Set output format
         //-------------------------------------------------------------------------
 
-        int const fileFormatIDToUse = ( outputFormat == FileFormat::Binary ) ? m_binaryWriteID : m_asciiWriterID;
+        int const fileFormatIDToUse = ( settings.m_outputFormat == FileFormat::Binary ) ? m_binaryWriteID : m_asciiWriterID;
+
+        // Compressed outputs are exported to a temporary file that is then compressed to the final path
+        std::string finalOutputFilepath = outputFilepath;
+        if ( settings.m_compressOutput && !Compression::HasCompressedFileExtension( finalOutputFilepath ) )
+        {
+            finalOutputFilepath += Compression::s_compressedFileExtension;
+        }
+        else if ( !settings.m_compressOutput && Compression::HasCompressedFileExtension( finalOutputFilepath ) )
+        {
+            finalOutputFilepath.resize( finalOutputFilepath.length() - strlen( Compression::s_compressedFileExtension ) );
+        }
+
+        // Embedded media is never written by the SDK, it's either streamed back into the exported file (so we export to a temporary file) or extracted next to it
+        bool const isStreamingMedia = m_importedMedia.HasMedia() && settings.m_mediaMode == EmbeddedMedia::Mode::Stream;
+        bool const isExtractingMedia = m_importedMedia.HasMedia() && settings.m_mediaMode == EmbeddedMedia::Mode::Extract;
+        m_pManager->GetIOSettings()->SetBoolProp( EXP_FBX_EMBEDDED, false );
+
+        std::string const exportFilepath = ( settings.m_compressOutput || isStreamingMedia ) ? FileSystemHelpers::GetTemporaryFilePath( ".fbx" ) : finalOutputFilepath;
+        bool const isTemporaryExportFile = exportFilepath != finalOutputFilepath;
 
         // Export
         //-------------------------------------------------------------------------
 
-        std::string const parentDirPath = FileSystemHelpers::GetParentDirectoryPath( outputFilepath );
+        std::string const parentDirPath = FileSystemHelpers::GetParentDirectoryPath( finalOutputFilepath );
         if ( !FileSystemHelpers::MakeDir( parentDirPath.c_str() ) )
         {
-            printf( "Error! Failed to create output directory (%s)!\n\n", outputFilepath.c_str() );
+            printf( "Error! Failed to create output directory (%s)!\n\n", finalOutputFilepath.c_str() );
+        }
+
+        if ( isExtractingMedia )
+        {
+            std::string uncompressedOutputFilepath = finalOutputFilepath;
+            if ( settings.m_compressOutput )
+            {
+                uncompressedOutputFilepath.resize( uncompressedOutputFilepath.length() - strlen( Compression::s_compressedFileExtension ) );
+            }
+
+            if ( !ExtractSceneMedia( pScene, uncompressedOutputFilepath ) )
+            {
+                return false;
+            }
         }
 
         //-------------------------------------------------------------------------
 
         FbxExporter* pExporter = FbxExporter::Create( m_pManager, "FBX Exporter" );
-        if ( !pExporter->Initialize( outputFilepath.c_str(), fileFormatIDToUse, m_pManager->GetIOSettings() ) )
+        bool isExporterInitialized = false;
+        {
+            Trace::ScopedSpan span( "FbxExporter::Initialize", inputFilepath );
+            isExporterInitialized = pExporter->Initialize( exportFilepath.c_str(), fileFormatIDToUse, m_pManager->GetIOSettings() );
+        }
+
+        if ( !isExporterInitialized )
         {
             printf( "Error! Failed to initialize exporter: %s\n\n", pExporter->GetStatus().GetErrorString() );
-            return 1;
+            pExporter->Destroy();
+            return false;
         }
 
-        if ( pExporter->Export( pScene ) )
+        bool exportSucceeded = false;
         {
-            printf( "Success!\nIn: %s \nOut (%s): %s\n\n", inputFilepath.c_str(), outputFormat == FileFormat::Binary ? "binary" : "ascii", outputFilepath.c_str() );
+            Trace::ScopedSpan span( "FbxExporter::Export", inputFilepath );
+            exportSucceeded = pExporter->Export( pScene );
         }
-        else
+
+        if ( !exportSucceeded )
         {
             printf( "Error! File export failed: - %s\n\n", pExporter->GetStatus().GetErrorString() );
         }
 
         pExporter->Destroy();
 
+        if ( !exportSucceeded )
+        {
+            FileSystemHelpers::DeleteTemporaryFile( isTemporaryExportFile, exportFilepath );
+            return false;
+        }
+
         //-------------------------------------------------------------------------
 
-        return 0;
+        std::string outputDataFilepath = exportFilepath;
+
+        if ( isStreamingMedia )
+        {
+            std::string const mediaOutputFilepath = settings.m_compressOutput ? FileSystemHelpers::GetTemporaryFilePath( ".fbx" ) : finalOutputFilepath;
+
+            std::string errorMessage;
+            bool const mediaSucceeded = EmbeddedMedia::WriteFileWithMedia( m_importedMedia, exportFilepath, mediaOutputFilepath, errorMessage );
+            FileSystemHelpers::DeleteTemporaryFile( true, exportFilepath );
+            if ( !mediaSucceeded )
+            {
+                printf( "Error! Failed to write embedded media to output file ( %s ): %s\n\n", finalOutputFilepath.c_str(), errorMessage.c_str() );
+                FileSystemHelpers::DeleteTemporaryFile( settings.m_compressOutput, mediaOutputFilepath );
+                return false;
+            }
+
+            outputDataFilepath = mediaOutputFilepath;
+        }
+
+        if ( settings.m_compressOutput )
+        {
+            std::string errorMessage;
+            if ( !Compression::CompressFile( outputDataFilepath, finalOutputFilepath, settings.m_numCompressionThreads, errorMessage ) )
+            {
+                printf( "Error! Failed to compress output file ( %s ): %s\n\n", finalOutputFilepath.c_str(), errorMessage.c_str() );
+                FileSystemHelpers::DeleteTemporaryFile( true, outputDataFilepath );
+                return false;
+            }
+
+            FileSystemHelpers::DeleteTemporaryFile( true, outputDataFilepath );
+        }
+
+        printf( "Success!\nIn: %s \nOut (%s%s): %s\n\n", inputFilepath.c_str(), settings.m_outputFormat == FileFormat::Binary ? "binary" : "ascii", settings.m_compressOutput ? ", compressed" : "", finalOutputFilepath.c_str() );
+        return true;
     }
 
     bool IsFbxFile( std::string const& inputFilepath )
     {
         assert( !inputFilepath.empty() );
+        Trace::ScopedSpan span( "IsFbxFile", inputFilepath );
+
+        if ( Compression::IsCompressedFile( inputFilepath ) )
+        {
+            return FileSystemHelpers::IsCompressedFbxFile( inputFilepath );
+        }
+
         int readerID = -1;
         auto pIOPluginRegistry = m_pManager->GetIOPluginRegistry();
         pIOPluginRegistry->DetectReaderFileFormat( inputFilepath.c_str(), readerID );
@@ -280,63 +645,837 @@ private:
     FbxConverter( FbxConverter const& ) = delete;
     FbxConverter& operator=( FbxConverter const& ) = delete;
 
+    void ReleaseImportedMedia()
+    {
+        FileSystemHelpers::DeleteTemporaryFile( m_importedMedia.m_isTemporaryFile, m_importedMedia.m_filePath );
+        m_importedMedia = EmbeddedMedia::MediaSource();
+    }
+
+    // Writes the embedded content of all the videos in the scene to the media folder next to the output, and points the videos and textures at the extracted files
+    bool ExtractSceneMedia( FbxScene* pScene, std::string const& outputFilepath )
+    {
+        std::string const mediaFolderPath = EmbeddedMedia::GetMediaFolderPath( outputFilepath );
+        std::string const mediaFolderName = mediaFolderPath.substr( mediaFolderPath.find_last_of( "\\/" ) + 1 );
+        bool mediaFolderCreated = false;
+
+        std::map<std::string, int> videoNameCounts;
+        std::set<std::string> usedFileNames;
+
+        int const numVideos = pScene->GetSrcObjectCount<FbxVideo>();
+        for ( int i = 0; i < numVideos; i++ )
+        {
+            FbxVideo* pVideo = pScene->GetSrcObject<FbxVideo>( i );
+            std::string const videoName = std::string( "Video::" ) + pVideo->GetName();
+            EmbeddedMedia::MediaBlob const* pBlob = EmbeddedMedia::FindBlob( m_importedMedia, videoName, videoNameCounts[videoName]++ );
+            if ( pBlob == nullptr )
+            {
+                continue;
+            }
+
+            // Use the original file name where possible, the same file name could be used by videos in different folders
+            std::string fileName = pBlob->m_fileName.substr( pBlob->m_fileName.find_last_of( "\\/" ) + 1 );
+            if ( fileName.empty() )
+            {
+                fileName = std::string( pVideo->GetName() ) + ".bin";
+            }
+
+            std::string lowercaseFileName = fileName;
+            std::transform( lowercaseFileName.begin(), lowercaseFileName.end(), lowercaseFileName.begin(), ::tolower );
+            if ( !usedFileNames.insert( lowercaseFileName ).second )
+            {
+                fileName = std::to_string( i ) + "_" + fileName;
+            }
+
+            //-------------------------------------------------------------------------
+
+            if ( !mediaFolderCreated )
+            {
+                if ( !FileSystemHelpers::MakeDir( mediaFolderPath.c_str() ) )
+                {
+                    printf( "Error! Failed to create media directory (%s)!\n\n", mediaFolderPath.c_str() );
+                    return false;
+                }
+
+                mediaFolderCreated = true;
+            }
+
+            std::string const extractedFilepath = mediaFolderPath + "\\" + fileName;
+            std::string const relativeFilepath = mediaFolderName + "\\" + fileName;
+
+            std::string errorMessage;
+            if ( !EmbeddedMedia::ExtractBlob( m_importedMedia, *pBlob, extractedFilepath, errorMessage ) )
+            {
+                printf( "Error! Failed to extract embedded media ( %s ): %s\n\n", extractedFilepath.c_str(), errorMessage.c_str() );
+                return false;
+            }
+
+            // Textures reference the media by file name rather than through the video
+            FbxString const originalFilepath = pVideo->GetFileName();
+            pVideo->SetFileName( extractedFilepath.c_str() );
+            pVideo->SetRelativeFileName( relativeFilepath.c_str() );
+
+            int const numTextures = pScene->GetSrcObjectCount<FbxFileTexture>();
+            for ( int j = 0; j < numTextures; j++ )
+            {
+                FbxFileTexture* pTexture = pScene->GetSrcObject<FbxFileTexture>( j );
+                if ( _stricmp( pTexture->GetFileName(), originalFilepath.Buffer() ) == 0 )
+                {
+                    pTexture->SetFileName( extractedFilepath.c_str() );
+                    pTexture->SetRelativeFileName( relativeFilepath.c_str() );
+                }
+            }
+        }
+
+        return true;
+    }
+
 private:
 
     FbxManager*             m_pManager = nullptr;
     int const               m_binaryWriteID = -1;
     int const               m_asciiWriterID = -1;
+    EmbeddedMedia::MediaSource  m_importedMedia;
 };
 
 //-------------------------------------------------------------------------
 
-static void PrintErrorAndHelp( char const* pErrorMessage = nullptr )
+// Splits a file into one output file per piece (see SceneSplitter). The FBX SDK isn't thread safe, so rather than importing once per piece
+// each converter imports the file once and the converters then share out the pieces and export them in parallel.
+static int SplitFbxFile( std::vector<FbxConverter*> const& converters, std::string const& inputFilepath, std::string const& outputFilepath, ConversionSettings const& settings )
 {
-    printf( "================================================\n" );
-    printf( "FBX File Format Converter\n" );
-    printf( "================================================\n" );
-    printf( "2020 - Bobby Anguelov - MIT License\n\n" );
+    assert( !converters.empty() && settings.m_splitMode != SceneSplitter::SplitMode::None );
+    Trace::ScopedSpan span( "SplitFbxFile", inputFilepath );
 
-    if ( pErrorMessage != nullptr )
+    // The allocation stats are recorded per thread, so each worker adds its own share once it is done
+    std::mutex allocationStatsMutex;
+    SdkAllocator::FileStats allocationStats;
+    auto AddThreadAllocationStats = [&] ()
     {
-        printf( "Error! %s\n\n", pErrorMessage );
+        SdkAllocator::FileStats const threadStats = SdkAllocator::EndFile();
+        std::lock_guard<std::mutex> lock( allocationStatsMutex );
+        allocationStats.m_numAllocations += threadStats.m_numAllocations;
+        allocationStats.m_peakBytes += threadStats.m_peakBytes;
+        allocationStats.m_numReleasedSlabs += threadStats.m_numReleasedSlabs;
+    };
+
+    SdkAllocator::BeginFile();
+
+    // Import on the first converter to find out how many pieces there are before paying for any additional imports
+    FbxScene* pScene = converters[0]->ImportScene( inputFilepath, settings );
+    if ( pScene == nullptr )
+    {
+        AddThreadAllocationStats();
+        PrintAllocationStats( inputFilepath, allocationStats );
+        return 1;
     }
 
-    printf( "Convert: -c <path> [-o <output path>] {-binary|-ascii}\n" );
-    printf( "Query: -q <path>\n" );
-}
+    std::vector<std::string> pieceNames;
+    SceneSplitter::GetPieceNames( pScene, settings.m_splitMode, pieceNames );
+    if ( pieceNames.empty() )
+    {
+        printf( "Error! No %s found to split ( %s )\n\n", SceneSplitter::GetSplitModeDescription( settings.m_splitMode ), inputFilepath.c_str() );
+        converters[0]->DestroyScene( pScene );
+        AddThreadAllocationStats();
+        PrintAllocationStats( inputFilepath, allocationStats );
+        return 1;
+    }
 
-static void PrintFileFormat( std::string const& filePath )
-{
-    FileFormat const fileFormat = FileSystemHelpers::GetFileFormat( filePath.c_str() );
+    //-------------------------------------------------------------------------
 
-    if ( fileFormat == FileFormat::Binary )
+    std::atomic<int> nextPieceIdx( 0 );
+    std::atomic<int> numFailedPieces( 0 );
+
+    auto ExportPieces = [&] ( FbxConverter* pConverter, FbxScene* pWorkerScene )
     {
-        printf( "%s - binary\n", filePath.c_str() );
-    }
-    else if ( fileFormat == FileFormat::Ascii )
+        int pieceIdx = 0;
+        while ( ( pieceIdx = nextPieceIdx++ ) < (int) pieceNames.size() )
+        {
+            SceneSplitter::ScenePiece const piece( pWorkerScene, settings.m_splitMode, pieceIdx );
+            std::string const pieceOutputPath = SceneSplitter::GetPieceOutputPath( outputFilepath, pieceNames[pieceIdx] );
+            if ( piece.GetScene() == nullptr )
+            {
+                printf( "Error! Failed to extract %s from file ( %s )\n\n", pieceNames[pieceIdx].c_str(), inputFilepath.c_str() );
+                numFailedPieces++;
+            }
+            else if ( !pConverter->ExportScene( piece.GetScene(), inputFilepath, pieceOutputPath, settings ) )
+            {
+                numFailedPieces++;
+            }
+        }
+    };
+
+    // If an additional import fails, the remaining converters simply pick up its share of the pieces
+    std::vector<std::thread> workers;
+    size_t const numWorkers = std::min( converters.size(), pieceNames.size() );
+    for ( size_t i = 1; i < numWorkers; i++ )
     {
-        printf( "%s - ascii\n", filePath.c_str() );
+        FbxConverter* pConverter = converters[i];
+        workers.emplace_back( [&, pConverter, i] ()
+        {
+            Trace::SetThreadName( "Split worker " + std::to_string( i ) );
+            SdkAllocator::BeginFile();
+
+            FbxScene* pWorkerScene = pConverter->ImportScene( inputFilepath, settings );
+            if ( pWorkerScene != nullptr )
+            {
+                ExportPieces( pConverter, pWorkerScene );
+                pConverter->DestroyScene( pWorkerScene );
+            }
+
+            AddThreadAllocationStats();
+        } );
     }
-    else
+
+    ExportPieces( converters[0], pScene );
+    converters[0]->DestroyScene( pScene );
+    AddThreadAllocationStats();
+
+    for ( auto& worker : workers )
     {
-        printf( "%s doesnt exist or is not an FBX file!\n", filePath.c_str() );
+        worker.join();
     }
+
+    // The workers run at the same time, so we report the sum of their peaks
+    PrintAllocationStats( inputFilepath, allocationStats );
+    return ( numFailedPieces > 0 ) ? 1 : 0;
 }
 
 //-------------------------------------------------------------------------
 
-int main( int argc, char* argv[] )
+struct BatchFile
 {
-    cli::Parser cmdParser( argc, argv );
-    cmdParser.disable_help();
-    cmdParser.set_optional<std::string>( "c", "convert", "" );
-    cmdParser.set_optional<std::string>( "o", "output", "" );
-    cmdParser.set_optional<std::string>( "q", "query", "" );
-    cmdParser.set_optional<bool>( "binary", "", false, ""  );
-    cmdParser.set_optional<bool>( "ascii", "", false, "" );
+    std::string             m_inputPath;
+    std::string             m_outputPath;
+    uint64_t                m_fileSize = 0;
+    uint64_t                m_estimatedPeakMemory = 0;
+};
+
+namespace BatchHelpers
+{
+    // Parses a shard argument of the form "i/N", the shard index is zero based
+    static bool ParseShardArgument( std::string const& shardArg, int& shardIndex, int& shardCount )
+    {
+        size_t const separatorIdx = shardArg.find( '/' );
+        if ( separatorIdx == std::string::npos || separatorIdx == 0 || separatorIdx == shardArg.length() - 1 )
+        {
+            return false;
+        }
+
+        try
+        {
+            size_t numParsedChars = 0;
+            std::string const indexStr = shardArg.substr( 0, separatorIdx );
+            shardIndex = std::stoi( indexStr, &numParsedChars );
+            if ( numParsedChars != indexStr.length() )
+            {
+                return false;
+            }
+
+            std::string const countStr = shardArg.substr( separatorIdx + 1 );
+            shardCount = std::stoi( countStr, &numParsedChars );
+            if ( numParsedChars != countStr.length() )
+            {
+                return false;
+            }
+        }
+        catch ( ... )
+        {
+            return false;
+        }
+
+        return shardCount > 0 && shardIndex >= 0 && shardIndex < shardCount;
+    }
+
+    // Keeps only the files belonging to the requested shard.
+    // Files are assigned largest first to the shard with the fewest bytes so far, so shards are balanced by size rather than by count.
+    // The assignment only depends on the paths and sizes of the files, so every machine computes the same partition from the same input directory.
+    static void SelectShard( std::vector<BatchFile>& batchFiles, int shardIndex, int shardCount )
+    {
+        assert( shardCount > 0 && shardIndex >= 0 && shardIndex < shardCount );
+
+        std::sort( batchFiles.begin(), batchFiles.end(), [] ( BatchFile const& a, BatchFile const& b )
+        {
+            if ( a.m_fileSize != b.m_fileSize )
+            {
+                return a.m_fileSize > b.m_fileSize;
+            }
+
+            return a.m_inputPath < b.m_inputPath;
+        } );
+
+        //-------------------------------------------------------------------------
+
+        std::vector<uint64_t> shardSizes( shardCount, 0 );
+        std::vector<BatchFile> selectedFiles;
+
+        for ( auto& batchFile : batchFiles )
+        {
+            int smallestShardIdx = 0;
+            for ( int i = 1; i < shardCount; i++ )
+            {
+                if ( shardSizes[i] < shardSizes[smallestShardIdx] )
+                {
+                    smallestShardIdx = i;
+                }
+            }
+
+            shardSizes[smallestShardIdx] += batchFile.m_fileSize;
+
+            if ( smallestShardIdx == shardIndex )
+            {
+                selectedFiles.emplace_back( batchFile );
+            }
+        }
+
+        batchFiles.swap( selectedFiles );
+    }
+
+    // Rough estimate of the peak memory needed to convert a file. Binary files store compressed arrays that expand considerably once
+    // imported while ascii files are mostly text that shrinks once parsed. The fixed overhead covers the importer/exporter working set.
+    // Compressed inputs are decompressed before they are imported, so the expansion applies to their decompressed size.
+    static uint64_t EstimatePeakMemory( std::string const& filePath, uint64_t fileSize )
+    {
+        static uint64_t const s_fixedOverhead = 32ull * 1024 * 1024;
+        static uint64_t const s_binaryExpansionFactor = 12;
+        static uint64_t const s_asciiExpansionFactor = 4;
+
+        FileFormat const fileFormat = FileSystemHelpers::GetFileFormat( filePath );
+        uint64_t const expansionFactor = ( fileFormat == FileFormat::Binary ) ? s_binaryExpansionFactor : s_asciiExpansionFactor;
+        uint64_t const dataSize = Compression::IsCompressedFile( filePath ) ? Compression::EstimateDecompressedSize( filePath ) : fileSize;
+        return s_fixedOverhead + dataSize * expansionFactor;
+    }
+
+    // If no output directory is supplied, we overwrite the source file, otherwise we mirror the input directory structure in the output directory
+    static BatchFile CreateBatchFile( std::string const& filePath, std::string const& inputDirectoryPath, std::string const& outputDirectoryPath )
+    {
+        BatchFile batchFile;
+        batchFile.m_inputPath = filePath;
+        batchFile.m_outputPath = filePath;
+        batchFile.m_fileSize = FileSystemHelpers::GetFileSizeInBytes( filePath );
+        batchFile.m_estimatedPeakMemory = EstimatePeakMemory( filePath, batchFile.m_fileSize );
+
+        if ( !outputDirectoryPath.empty() )
+        {
+            batchFile.m_outputPath.replace( 0, inputDirectoryPath.length() - 1, outputDirectoryPath.c_str() );
+        }
+
+        return batchFile;
+    }
+
+    // Returns true if the output for the file is missing or older than the file. The output of in-place and split conversions can't be
+    // told apart from the input or has no single path, so those are never considered out of date.
+    static bool IsOutputOutOfDate( std::string const& filePath, std::string const& inputDirectoryPath, std::string const& outputDirectoryPath, ConversionSettings const& settings )
+    {
+        if ( outputDirectoryPath.empty() || settings.m_splitMode != SceneSplitter::SplitMode::None )
+        {
+            return false;
+        }
+
+        std::string outputPath = filePath;
+        outputPath.replace( 0, inputDirectoryPath.length() - 1, outputDirectoryPath.c_str() );
+
+        // Matches the extension change made on export
+        if ( settings.m_compressOutput && !Compression::HasCompressedFileExtension( outputPath ) )
+        {
+            outputPath += Compression::s_compressedFileExtension;
+        }
+        else if ( !settings.m_compressOutput && Compression::HasCompressedFileExtension( outputPath ) )
+        {
+            outputPath.resize( outputPath.length() - strlen( Compression::s_compressedFileExtension ) );
+        }
+
+        return FileSystemHelpers::GetFileLastWriteTime( outputPath ) < FileSystemHelpers::GetFileLastWriteTime( filePath );
+    }
+
+    // Parses a memory size such as "512M" or "64G", values without a suffix are in megabytes
+    static bool ParseMemorySize( std::string const& memorySizeArg, uint64_t& memorySize )
+    {
+        try
+        {
+            size_t numParsedChars = 0;
+            uint64_t const value = std::stoull( memorySizeArg, &numParsedChars );
+
+            uint64_t multiplier = 1024ull * 1024;
+            if ( numParsedChars < memorySizeArg.length() )
+            {
+                if ( numParsedChars != memorySizeArg.length() - 1 )
+                {
+                    return false;
+                }
+
+                char const suffix = (char) toupper( memorySizeArg.back() );
+                if ( suffix == 'G' )
+                {
+                    multiplier = 1024ull * 1024 * 1024;
+                }
+                else if ( suffix != 'M' )
+                {
+                    return false;
+                }
+            }
+
+            memorySize = value * multiplier;
+        }
+        catch ( ... )
+        {
+            return false;
+        }
+
+        return memorySize > 0;
+    }
+
+    static bool WriteShardManifest( std::string const& manifestPath, std::vector<BatchFile> const& batchFiles, int shardIndex, int shardCount )
+    {
+        std::string const parentDirPath = FileSystemHelpers::GetParentDirectoryPath( manifestPath );
+        if ( !parentDirPath.empty() )
+        {
+            FileSystemHelpers::MakeDir( parentDirPath.c_str() );
+        }
+
+        FILE* fp = nullptr;
+        int errcode = fopen_s( &fp, manifestPath.c_str(), "w" );
+        if ( errcode != 0 )
+        {
+            return false;
+        }
+
+        uint64_t totalSize = 0;
+        for ( auto const& batchFile : batchFiles )
+        {
+            totalSize += batchFile.m_fileSize;
+        }
+
+        fprintf( fp, "# shard: %d/%d\n", shardIndex, shardCount );
+        fprintf( fp, "# files: %zu\n", batchFiles.size() );
+        fprintf( fp, "# bytes: %llu\n", (unsigned long long) totalSize );
+
+        for ( auto const& batchFile : batchFiles )
+        {
+            fprintf( fp, "%llu\t%s\t%s\n", (unsigned long long) batchFile.m_fileSize, batchFile.m_inputPath.c_str(), batchFile.m_outputPath.c_str() );
+        }
+
+        fclose( fp );
+        return true;
+    }
+}
+
+//-------------------------------------------------------------------------
+
+// Converts a list of files on a set of worker threads. Each worker owns its own converter since the FBX SDK manager is not thread safe.
+// Files are started largest first so the big conversions don't end up as a long tail, and new work is only admitted while the
+// estimated memory of all in-flight conversions stays within the budget.
+class BatchScheduler
+{
+public:
+
+    BatchScheduler( int numWorkers, uint64_t memoryBudget )
+        : m_memoryBudget( memoryBudget )
+    {
+        assert( numWorkers > 0 );
+        for ( int i = 0; i < numWorkers; i++ )
+        {
+            m_converters.emplace_back( new FbxConverter() );
+        }
+    }
+
+    void Run( std::vector<BatchFile> const& batchFiles, ConversionSettings const& settings )
+    {
+        m_pendingFiles.clear();
+        for ( auto const& batchFile : batchFiles )
+        {
+            m_pendingFiles.emplace_back( &batchFile );
+        }
+
+        std::stable_sort( m_pendingFiles.begin(), m_pendingFiles.end(), [] ( BatchFile const* pA, BatchFile const* pB )
+        {
+            return pA->m_estimatedPeakMemory > pB->m_estimatedPeakMemory;
+        } );
+
+        m_inFlightMemory = 0;
+        m_numInFlight = 0;
+
+        //-------------------------------------------------------------------------
+
+        std::vector<std::thread> workers;
+        for ( size_t i = 0; i < m_converters.size(); i++ )
+        {
+            FbxConverter* pWorkerConverter = m_converters[i].get();
+            workers.emplace_back( [this, pWorkerConverter, &settings, i] ()
+            {
+                Trace::SetThreadName( "Batch worker " + std::to_string( i ) );
+                WorkerLoop( *pWorkerConverter, settings );
+            } );
+        }
+
+        for ( auto& worker : workers )
+        {
+            worker.join();
+        }
+    }
+
+private:
+
+    // Returns the index of the largest pending file that fits within the remaining budget, or -1 if nothing fits.
+    // A file larger than the whole budget is still allowed to run on its own so that we never stall.
+    int FindNextFileToConvert() const
+    {
+        if ( m_pendingFiles.empty() )
+        {
+            return -1;
+        }
+
+        if ( m_memoryBudget == 0 || m_numInFlight == 0 )
+        {
+            return 0;
+        }
+
+        for ( size_t i = 0; i < m_pendingFiles.size(); i++ )
+        {
+            if ( m_inFlightMemory + m_pendingFiles[i]->m_estimatedPeakMemory <= m_memoryBudget )
+            {
+                return (int) i;
+            }
+        }
+
+        return -1;
+    }
+
+    void WorkerLoop( FbxConverter& converter, ConversionSettings const& settings )
+    {
+        while ( true )
+        {
+            BatchFile const* pBatchFile = nullptr;
+
+            {
+                // Covers both the wait for a free slot in the memory budget and the contention on the scheduler lock
+                Trace::ScopedSpan span( "WaitForWork" );
+                std::unique_lock<std::mutex> lock( m_mutex );
+                int fileIdx = -1;
+                m_workAvailableCV.wait( lock, [this, &fileIdx] ()
+                {
+                    fileIdx = FindNextFileToConvert();
+                    return fileIdx != -1 || m_pendingFiles.empty();
+                } );
+
+                if ( fileIdx == -1 )
+                {
+                    break;
+                }
+
+                pBatchFile = m_pendingFiles[fileIdx];
+                m_pendingFiles.erase( m_pendingFiles.begin() + fileIdx );
+                m_inFlightMemory += pBatchFile->m_estimatedPeakMemory;
+                m_numInFlight++;
+            }
+
+            //-------------------------------------------------------------------------
+
+            if ( settings.m_splitMode != SceneSplitter::SplitMode::None )
+            {
+                SplitFbxFile( { &converter }, pBatchFile->m_inputPath, pBatchFile->m_outputPath, settings );
+            }
+            else
+            {
+                converter.ConvertFbxFile( pBatchFile->m_inputPath, pBatchFile->m_outputPath, settings );
+            }
+
+            //-------------------------------------------------------------------------
+
+            {
+                std::lock_guard<std::mutex> lock( m_mutex );
+                m_inFlightMemory -= pBatchFile->m_estimatedPeakMemory;
+                m_numInFlight--;
+            }
+
+            m_workAvailableCV.notify_all();
+        }
+    }
+
+private:
+
+    BatchScheduler( BatchScheduler const& ) = delete;
+    BatchScheduler& operator=( BatchScheduler const& ) = delete;
+
+private:
+
+    std::vector<std::unique_ptr<FbxConverter>>  m_converters;
+    uint64_t const                              m_memoryBudget = 0;
+
+    std::mutex                                  m_mutex;
+    std::condition_variable                     m_workAvailableCV;
+    std::vector<BatchFile const*>               m_pendingFiles;
+    uint64_t                                    m_inFlightMemory = 0;
+    int                                         m_numInFlight = 0;
+};
+
+//-------------------------------------------------------------------------
+
+static std::atomic<bool> g_stopWatching( false );
+
+static BOOL WINAPI OnConsoleCtrlEvent( DWORD )
+{
+    g_stopWatching = true;
+    return TRUE;
+}
+
+// Converts the files that are created or modified in the input folder until the user hits ctrl-c. The scheduler (and its converters) stays
+// alive between changes, so only the changed files are converted and we never pay for a rescan or for recreating the SDK managers.
+// Files are only converted once they've stopped changing and no one has them open anymore, so we don't pick up partially written files.
+static int WatchFolder( FbxConverter& fbxConverter, BatchScheduler& batchScheduler, std::string const& inputDirectoryPath, std::string const& outputDirectoryPath, ConversionSettings const& settings )
+{
+    static uint64_t const s_settleTimeMS = 500;
+    static DWORD const s_pollTimeMS = 100;
+
+    FolderWatcher folderWatcher( inputDirectoryPath );
+    if ( !folderWatcher.IsValid() )
+    {
+        printf( "Error! Failed to watch directory (%s)!\n\n", inputDirectoryPath.c_str() );
+        return 1;
+    }
+
+    g_stopWatching = false;
+    SetConsoleCtrlHandler( OnConsoleCtrlEvent, TRUE );
+    printf( "Watching: %s\nOut: %s\nPress ctrl-c to stop.\n\n", inputDirectoryPath.c_str(), outputDirectoryPath.c_str() );
+
+    // The time of the last change for each file that needs to be converted
+    std::map<std::string, uint64_t> pendingFiles;
+    uint64_t lastChangeFileTime = FileSystemHelpers::GetCurrentFileTime();
+
+    std::vector<std::string> changedPaths;
+    std::vector<BatchFile> batchFiles;
+    int result = 0;
+
+    while ( !g_stopWatching )
+    {
+        changedPaths.clear();
+        FolderWatcher::WaitResult const waitResult = folderWatcher.WaitForChanges( s_pollTimeMS, changedPaths );
+        if ( waitResult == FolderWatcher::WaitResult::Error )
+        {
+            printf( "Error! Stopped receiving changes for directory (%s)!\n\n", inputDirectoryPath.c_str() );
+            result = 1;
+            break;
+        }
+
+        // The changes were lost, so we check the whole folder for anything written since the last batch of changes. Files that were moved in
+        // keep their old write time, so anything whose output is missing or older than the file is picked up as well.
+        if ( waitResult == FolderWatcher::WaitResult::Overflow )
+        {
+            printf( "Warning! Too many changes at once, rescanning %s\n\n", inputDirectoryPath.c_str() );
+
+            std::vector<std::string> directoryContents;
+            FileSystemHelpers::GetDirectoryContents( inputDirectoryPath, directoryContents );
+            for ( auto& filePath : directoryContents )
+            {
+                if ( FileSystemHelpers::GetFileLastWriteTime( filePath ) >= lastChangeFileTime || BatchHelpers::IsOutputOutOfDate( filePath, inputDirectoryPath, outputDirectoryPath, settings ) )
+                {
+                    changedPaths.emplace_back( filePath );
+                }
+            }
+        }
+
+        if ( waitResult != FolderWatcher::WaitResult::Timeout )
+        {
+            lastChangeFileTime = FileSystemHelpers::GetCurrentFileTime();
+        }
+
+        uint64_t const currentTime = GetTickCount64();
+        for ( auto& changedPath : changedPaths )
+        {
+            pendingFiles[changedPath] = currentTime;
+        }
+
+        //-------------------------------------------------------------------------
+
+        batchFiles.clear();
+        std::vector<std::string> directoryContents;
+        for ( auto iter = pendingFiles.begin(); iter != pendingFiles.end(); )
+        {
+            if ( currentTime - iter->second < s_settleTimeMS )
+            {
+                ++iter;
+                continue;
+            }
+
+            if ( FileSystemHelpers::IsFileInUse( iter->first ) )
+            {
+                iter->second = currentTime;
+                ++iter;
+                continue;
+            }
+
+            // Directories that were moved or copied in only show up as a single change, so their files are queued instead. Deleted files
+            // and non-FBX files are simply dropped.
+            if ( FileSystemHelpers::IsValidDirectoryPath( iter->first ) )
+            {
+                FileSystemHelpers::GetDirectoryContents( iter->first + "\\", directoryContents );
+            }
+            else if ( FileSystemHelpers::IsValidFilePath( iter->first ) && fbxConverter.IsFbxFile( iter->first ) )
+            {
+                batchFiles.emplace_back( BatchHelpers::CreateBatchFile( iter->first, inputDirectoryPath, outputDirectoryPath ) );
+            }
+
+            iter = pendingFiles.erase( iter );
+        }
+
+        // The files still need to settle, they might have only just been copied in with their directory
+        for ( auto& filePath : directoryContents )
+        {
+            pendingFiles[filePath] = currentTime;
+        }
+
+        if ( !batchFiles.empty() )
+        {
+            batchScheduler.Run( batchFiles, settings );
+        }
+    }
+
+    SetConsoleCtrlHandler( OnConsoleCtrlEvent, FALSE );
+    return result;
+}
+
+//-------------------------------------------------------------------------
+
+static void PrintErrorAndHelp( char const* pErrorMessage = nullptr )
+{
+    printf( "================================================\n" );
+    printf( "FBX File Format Converter\n" );
+    printf( "================================================\n" );
+    printf( "2020 - Bobby Anguelov - MIT License\n\n" );
+
+    if ( pErrorMessage != nullptr )
+    {
+        printf( "Error! %s\n\n", pErrorMessage );
+    }
+
+    printf( "Convert: -c <path> [-o <output path>] {-binary|-ascii} [-gz] [-shard <i/N>] [-manifest <path>] [-j <jobs>] [-mem-budget <size>] [-split <meshes|stacks>] [-media <stream|extract>] [-watch] [-alloc <pool|count>] [-triangulate] [-tangents] [-trace <file.json>]\n" );
+    printf( "Filter: [-include-nodes <patterns>] [-exclude-nodes <patterns>] [-include-types <types>] [-exclude-types <types>] [-include-stacks <patterns>] [-exclude-stacks <patterns>]\n" );
+    printf( "Query: -q <path>\n" );
+    printf( "Verify: -verify <path a> <path b> [-tolerance <value>]\n" );
+}
+
+static void PrintFileFormat( std::string const& filePath )
+{
+    FileFormat const fileFormat = FileSystemHelpers::GetFileFormat( filePath.c_str() );
+    char const* pCompressedTag = Compression::IsCompressedFile( filePath ) ? " (compressed)" : "";
+
+    if ( fileFormat == FileFormat::Binary )
+    {
+        printf( "%s - binary%s\n", filePath.c_str(), pCompressedTag );
+    }
+    else if ( fileFormat == FileFormat::Ascii )
+    {
+        printf( "%s - ascii%s\n", filePath.c_str(), pCompressedTag );
+    }
+    else
+    {
+        printf( "%s doesnt exist or is not an FBX file!\n", filePath.c_str() );
+    }
+}
+
+// Compares two FBX files (of any format) at the node/property level
+static int VerifyFbxFiles( std::string const& filePathA, std::string const& filePathB, double tolerance )
+{
+    FbxRaw::Document documentA, documentB;
+    std::string errorMessageA, errorMessageB;
+    bool loadedA = false, loadedB = false;
+
+    // Both files are loaded at the same time, so they each get half the cores for parsing
+    int const numThreadsPerFile = std::max( 1, (int) std::thread::hardware_concurrency() / 2 );
+    std::thread loadThread( [&] () { loadedB = FbxRaw::ReadFile( filePathB, documentB, errorMessageB, numThreadsPerFile ); } );
+    loadedA = FbxRaw::ReadFile( filePathA, documentA, errorMessageA, numThreadsPerFile );
+    loadThread.join();
+
+    if ( !loadedA )
+    {
+        printf( "Error! Failed to read FBX file ( %s ): %s\n\n", filePathA.c_str(), errorMessageA.c_str() );
+        return 1;
+    }
+
+    if ( !loadedB )
+    {
+        printf( "Error! Failed to read FBX file ( %s ): %s\n\n", filePathB.c_str(), errorMessageB.c_str() );
+        return 1;
+    }
+
+    //-------------------------------------------------------------------------
+
+    FbxVerify::Settings settings;
+    settings.m_tolerance = tolerance;
+
+    std::string differencePath, differenceDescription;
+    if ( !FbxVerify::CompareDocuments( documentA, documentB, settings, differencePath, differenceDescription ) )
+    {
+        printf( "Files differ!\nA: %s\nB: %s\nAt: %s\n%s\n\n", filePathA.c_str(), filePathB.c_str(), differencePath.c_str(), differenceDescription.c_str() );
+        return 1;
+    }
+
+    printf( "Files match!\nA: %s\nB: %s\n\n", filePathA.c_str(), filePathB.c_str() );
+    return 0;
+}
+
+//-------------------------------------------------------------------------
+
+int main( int argc, char* argv[] )
+{
+    cli::Parser cmdParser( argc, argv );
+    cmdParser.disable_help();
+    cmdParser.set_optional<std::string>( "c", "convert", "" );
+    cmdParser.set_optional<std::string>( "o", "output", "" );
+    cmdParser.set_optional<std::string>( "q", "query", "" );
+    cmdParser.set_optional<bool>( "binary", "", false, ""  );
+    cmdParser.set_optional<bool>( "ascii", "", false, "" );
+    cmdParser.set_optional<bool>( "gz", "", false, "" );
+    cmdParser.set_optional<std::string>( "shard", "shard", "" );
+    cmdParser.set_optional<std::string>( "manifest", "manifest", "" );
+    cmdParser.set_optional<int>( "j", "jobs", 1 );
+    cmdParser.set_optional<std::string>( "mem-budget", "mem-budget", "" );
+    cmdParser.set_optional<std::vector<std::string>>( "verify", "verify", std::vector<std::string>() );
+    cmdParser.set_optional<double>( "tolerance", "tolerance", 1e-6 );
+    cmdParser.set_optional<std::string>( "include-nodes", "include-nodes", "" );
+    cmdParser.set_optional<std::string>( "exclude-nodes", "exclude-nodes", "" );
+    cmdParser.set_optional<std::string>( "include-types", "include-types", "" );
+    cmdParser.set_optional<std::string>( "exclude-types", "exclude-types", "" );
+    cmdParser.set_optional<std::string>( "include-stacks", "include-stacks", "" );
+    cmdParser.set_optional<std::string>( "exclude-stacks", "exclude-stacks", "" );
+    cmdParser.set_optional<std::string>( "split", "split", "" );
+    cmdParser.set_optional<std::string>( "media", "media", "" );
+    cmdParser.set_optional<bool>( "watch", "", false, "" );
+    cmdParser.set_optional<std::string>( "alloc", "alloc", "" );
+    cmdParser.set_optional<bool>( "triangulate", "", false, "" );
+    cmdParser.set_optional<bool>( "tangents", "", false, "" );
+    cmdParser.set_optional<std::string>( "trace", "trace", "" );
 
     if ( cmdParser.run() )
     {
+        // The allocation handlers need to be installed before the SDK allocates anything, i.e. before the first manager is created
+        auto const allocModeArg = cmdParser.get<std::string>( "alloc" );
+        if ( !allocModeArg.empty() )
+        {
+            SdkAllocator::Mode allocMode = SdkAllocator::Mode::Default;
+            if ( !SdkAllocator::ParseMode( allocModeArg, allocMode ) )
+            {
+                PrintErrorAndHelp( "Invalid allocator mode, expected -alloc <pool|count>." );
+                return 1;
+            }
+
+            SdkAllocator::Install( allocMode );
+        }
+
+        // The trace is written when the session goes out of scope, by then all the converters and their threads are gone
+        Trace::ScopedSession traceSession;
+        auto const traceFilePath = cmdParser.get<std::string>( "trace" );
+        if ( !traceFilePath.empty() )
+        {
+            std::string errorMessage;
+            if ( !Trace::Begin( FileSystemHelpers::GetFullPathString( traceFilePath ), errorMessage ) )
+            {
+                printf( "Error! Failed to start trace ( %s ): %s\n\n", traceFilePath.c_str(), errorMessage.c_str() );
+                return 1;
+            }
+
+            Trace::SetThreadName( "Main" );
+        }
+
         FbxConverter fbxConverter;
 
         //-------------------------------------------------------------------------
@@ -355,62 +1494,180 @@ int main( int argc, char* argv[] )
             {
                 PrintErrorAndHelp( "Either -ascii or -binary required!" );
             }
+            else if ( outputAsBinary && cmdParser.get<bool>( "gz" ) )
+            {
+                PrintErrorAndHelp( "-gz is only supported for ascii output, binary files are already compressed." );
+            }
             else
             {
-                FileFormat const outputFormat = outputAsBinary ? FileFormat::Binary : FileFormat::Ascii;
+                ConversionSettings settings;
+                settings.m_outputFormat = outputAsBinary ? FileFormat::Binary : FileFormat::Ascii;
+                settings.m_compressOutput = cmdParser.get<bool>( "gz" );
+                settings.m_numCompressionThreads = std::max( 1, (int) std::thread::hardware_concurrency() );
+                settings.m_meshProcessing.m_triangulate = cmdParser.get<bool>( "triangulate" );
+                settings.m_meshProcessing.m_generateTangents = cmdParser.get<bool>( "tangents" );
+                settings.m_meshProcessing.m_numThreads = settings.m_numCompressionThreads;
+                settings.m_filter.m_includedNodes = cmdParser.get<std::string>( "include-nodes" );
+                settings.m_filter.m_excludedNodes = cmdParser.get<std::string>( "exclude-nodes" );
+                settings.m_filter.m_includedAnimStacks = cmdParser.get<std::string>( "include-stacks" );
+                settings.m_filter.m_excludedAnimStacks = cmdParser.get<std::string>( "exclude-stacks" );
+                SceneFilter::SplitList( cmdParser.get<std::string>( "include-types" ), settings.m_filter.m_includedTypes );
+                SceneFilter::SplitList( cmdParser.get<std::string>( "exclude-types" ), settings.m_filter.m_excludedTypes );
+
+                std::string filterErrorMessage;
+                if ( !settings.m_filter.Validate( filterErrorMessage ) )
+                {
+                    PrintErrorAndHelp( filterErrorMessage.c_str() );
+                    return 1;
+                }
+
+                auto const splitModeArg = cmdParser.get<std::string>( "split" );
+                if ( !splitModeArg.empty() && !SceneSplitter::ParseSplitMode( splitModeArg, settings.m_splitMode ) )
+                {
+                    PrintErrorAndHelp( "Invalid split mode, expected -split <meshes|stacks>." );
+                    return 1;
+                }
+
+                auto const mediaModeArg = cmdParser.get<std::string>( "media" );
+                if ( !mediaModeArg.empty() && !EmbeddedMedia::ParseMode( mediaModeArg, settings.m_mediaMode ) )
+                {
+                    PrintErrorAndHelp( "Invalid media mode, expected -media <stream|extract>." );
+                    return 1;
+                }
+
+                int numJobs = cmdParser.get<int>( "j" );
+                if ( numJobs <= 0 )
+                {
+                    numJobs = std::max( 1, (int) std::thread::hardware_concurrency() );
+                }
 
                 inputConvertPath = FileSystemHelpers::GetFullPathString( inputConvertPath );
                 if ( FileSystemHelpers::IsValidDirectoryPath( inputConvertPath ) )
                 {
-                    std::vector<std::string> directoryContents;
-                    FileSystemHelpers::GetDirectoryContents( inputConvertPath, directoryContents );
+                    int shardIndex = 0;
+                    int shardCount = 1;
+                    auto const shardArg = cmdParser.get<std::string>( "shard" );
+                    if ( !shardArg.empty() && !BatchHelpers::ParseShardArgument( shardArg, shardIndex, shardCount ) )
+                    {
+                        PrintErrorAndHelp( "Invalid shard argument, expected -shard <i/N> with 0 <= i < N." );
+                        return 1;
+                    }
+
+                    uint64_t memoryBudget = 0;
+                    auto const memoryBudgetArg = cmdParser.get<std::string>( "mem-budget" );
+                    if ( !memoryBudgetArg.empty() && !BatchHelpers::ParseMemorySize( memoryBudgetArg, memoryBudget ) )
+                    {
+                        PrintErrorAndHelp( "Invalid memory budget, expected -mem-budget <size> e.g. 512M or 48G." );
+                        return 1;
+                    }
 
                     auto outputPath = cmdParser.get<std::string>( "o" );
-                    if ( outputPath.empty() )
+                    if ( !outputPath.empty() )
+                    {
+                        outputPath = FileSystemHelpers::GetFullPathString( outputPath );
+                    }
+
+                    // Parallel jobs share the cores used for processing meshes and compressing the output
+                    settings.m_numCompressionThreads = std::max( 1, settings.m_numCompressionThreads / numJobs );
+                    settings.m_meshProcessing.m_numThreads = settings.m_numCompressionThreads;
+
+                    //-------------------------------------------------------------------------
+
+                    if ( cmdParser.get<bool>( "watch" ) )
                     {
-                        for ( auto& filePath : directoryContents )
+                        if ( !shardArg.empty() || !cmdParser.get<std::string>( "manifest" ).empty() )
                         {
-                            if ( !fbxConverter.IsFbxFile( filePath.c_str() ) )
-                            {
-                                continue;
-                            }
+                            PrintErrorAndHelp( "-shard and -manifest are not supported with -watch." );
+                            return 1;
+                        }
 
-                            fbxConverter.ConvertFbxFile( filePath.c_str(), filePath.c_str(), outputFormat );
+                        // Converting into the watched folder would trigger new conversions of our own output
+                        std::string const outputDirectoryPath = ( outputPath.empty() || outputPath.back() == '\\' ) ? outputPath : outputPath + '\\';
+                        if ( outputDirectoryPath.empty() || _strnicmp( outputDirectoryPath.c_str(), inputConvertPath.c_str(), inputConvertPath.length() ) == 0 )
+                        {
+                            PrintErrorAndHelp( "-watch requires an output folder (-o) outside the watched folder." );
+                            return 1;
                         }
 
-                        return 0;
+                        BatchScheduler batchScheduler( numJobs, memoryBudget );
+                        return WatchFolder( fbxConverter, batchScheduler, inputConvertPath, outputPath, settings );
                     }
-                    else // Convert and copy
-                    {
-                        outputPath = FileSystemHelpers::GetFullPathString( outputPath );
 
-                        for ( auto& filePath : directoryContents )
+                    //-------------------------------------------------------------------------
+
+                    std::vector<std::string> directoryContents;
+                    FileSystemHelpers::GetDirectoryContents( inputConvertPath, directoryContents );
+
+                    std::vector<BatchFile> batchFiles;
+                    for ( auto& filePath : directoryContents )
+                    {
+                        if ( !fbxConverter.IsFbxFile( filePath ) )
                         {
-                            if ( !fbxConverter.IsFbxFile( filePath ) )
-                            {
-                                continue;
-                            }
-
-                            std::string newOutputPath = filePath;
-                            newOutputPath.replace( 0, inputConvertPath.length() - 1, outputPath.c_str() );
-                            fbxConverter.ConvertFbxFile( filePath, newOutputPath, outputFormat );
+                            continue;
                         }
 
-                        return 0;
+                        batchFiles.emplace_back( BatchHelpers::CreateBatchFile( filePath, inputConvertPath, outputPath ) );
+                    }
+
+                    if ( !shardArg.empty() )
+                    {
+                        BatchHelpers::SelectShard( batchFiles, shardIndex, shardCount );
                     }
+
+                    auto manifestPath = cmdParser.get<std::string>( "manifest" );
+                    if ( !manifestPath.empty() )
+                    {
+                        manifestPath = FileSystemHelpers::GetFullPathString( manifestPath );
+                        if ( !BatchHelpers::WriteShardManifest( manifestPath, batchFiles, shardIndex, shardCount ) )
+                        {
+                            printf( "Error! Failed to write shard manifest (%s)!\n\n", manifestPath.c_str() );
+                            return 1;
+                        }
+                    }
+
+                    //-------------------------------------------------------------------------
+
+                    BatchScheduler batchScheduler( numJobs, memoryBudget );
+                    batchScheduler.Run( batchFiles, settings );
+
+                    return 0;
                 }
                 else
                 {
-                    auto outputPath = cmdParser.get<std::string>( "o" );
-                    if ( outputPath.empty() )
+                    bool const isSplitting = settings.m_splitMode != SceneSplitter::SplitMode::None;
+                    bool const hasBatchOnlyArgs = !cmdParser.get<std::string>( "shard" ).empty() || !cmdParser.get<std::string>( "manifest" ).empty() || ( cmdParser.get<int>( "j" ) != 1 && !isSplitting ) || !cmdParser.get<std::string>( "mem-budget" ).empty();
+                    if ( hasBatchOnlyArgs )
                     {
-                        return fbxConverter.ConvertFbxFile( inputConvertPath, inputConvertPath, outputFormat );
+                        PrintErrorAndHelp( "-shard, -manifest and -mem-budget are only supported when converting a folder, -j requires a folder or -split." );
+                        return 1;
                     }
-                    else
+
+                    if ( cmdParser.get<bool>( "watch" ) )
                     {
-                        outputPath = FileSystemHelpers::GetFullPathString( outputPath );
-                        return fbxConverter.ConvertFbxFile( inputConvertPath, outputPath, outputFormat );
+                        PrintErrorAndHelp( "-watch requires a folder." );
+                        return 1;
                     }
+
+                    auto outputPath = cmdParser.get<std::string>( "o" );
+                    outputPath = outputPath.empty() ? inputConvertPath : FileSystemHelpers::GetFullPathString( outputPath );
+
+                    if ( isSplitting )
+                    {
+                        // The pieces of a single file are exported in parallel, each job needs its own converter
+                        std::vector<std::unique_ptr<FbxConverter>> additionalConverters;
+                        std::vector<FbxConverter*> converters = { &fbxConverter };
+                        for ( int i = 1; i < numJobs; i++ )
+                        {
+                            additionalConverters.emplace_back( new FbxConverter() );
+                            converters.emplace_back( additionalConverters.back().get() );
+                        }
+
+                        settings.m_numCompressionThreads = std::max( 1, settings.m_numCompressionThreads / numJobs );
+                        settings.m_meshProcessing.m_numThreads = settings.m_numCompressionThreads;
+                        return SplitFbxFile( converters, inputConvertPath, outputPath, settings );
+                    }
+
+                    return fbxConverter.ConvertFbxFile( inputConvertPath, outputPath, settings );
                 }
             }
         }
@@ -440,6 +1697,17 @@ int main( int argc, char* argv[] )
                     PrintFileFormat( inputQueryPath );
                 }
             }
+            else if ( !cmdParser.get<std::vector<std::string>>( "verify" ).empty() )
+            {
+                auto const verifyPaths = cmdParser.get<std::vector<std::string>>( "verify" );
+                if ( verifyPaths.size() != 2 )
+                {
+                    PrintErrorAndHelp( "-verify requires exactly two files." );
+                    return 1;
+                }
+
+                return VerifyFbxFiles( FileSystemHelpers::GetFullPathString( verifyPaths[0] ), FileSystemHelpers::GetFullPathString( verifyPaths[1] ), cmdParser.get<double>( "tolerance" ) );
+            }
             else
             {
                 PrintErrorAndHelp( "Invalid Arguments!" );
@@ -454,4 +1722,4 @@ int main( int argc, char* argv[] )
     }
 
     return 1;
-}
\ No newline at end of file
+}
\ No newline at end of file